@@ -19,274 +19,108 @@
 
 #include "heap/Buddy.h"
 
-#include "algorithm/Math.h"
+#ifdef HEAP_EXTENSIONS
+#include "heap/BitmapBuddy.h"
+#include "heap/LazyBuddy.h"
+#endif
 
-#include "1test/Test.h"
+#include "TestHeapBuddySuite.h"
 
-TEST_GROUP(BuddyInline)
-{
-    static constexpr auto size = 16;
-    uint32_t mem[size];
-
-    pet::BuddyAllocator<2, 2> uut;
-
-    bool isUnique(void** ptrs, size_t n)
-    {
-        for(int i = 1; i < n; i++)
-        {
-            for(int j = 0; j < i; j++)
-            {
-                if(ptrs[i] == ptrs[j])
-                    return false;
-            }
-        }
-
-        return true;
-    }
-
-    void steppingShuffle(int size)
-    {
-        void* ptrs[1024], **p = ptrs;
-
-        do {
-            *p = uut.allocate(size);
-        } while(*p++);
+#include <algorithm>
 
-        CHECK(isUnique(ptrs, p - ptrs));
+template class BuddyTest<pet::BuddyAllocator<2, 2>>;
 
-        for(int n = 1; n < p - ptrs; n++)
-        {
-            CHECK(!uut.allocate(size));
+#ifdef HEAP_EXTENSIONS
+template class BuddyTest<pet::BitmapBuddyAllocator<2, 2>>;
+template class BuddyTest<pet::LazyBuddyAllocator<2, 2, 4>>;
 
-            for(int i = 0; i < n; i++)
-                uut.free(ptrs[i]);
+TEST_GROUP(LazyBuddy)
+{
+    static constexpr auto watermark = 4;
 
-            for(int i = 0; i < n; i++) {
-                ptrs[i] = uut.allocate(size);
-                CHECK(ptrs[i]);
-            }
+    uint32_t mem[256];
+    char offlineTree[256];
 
-            CHECK(isUnique(ptrs, p - ptrs));
-        }
-    }
+    pet::LazyBuddyAllocator<2, 2, watermark> uut;
 
-    void runRandomStress(uint32_t sizeMult = 1)
-    {
-        void* ptrs[1024];
-        int idx = 0;
-        int a = 1, b = 1;
-
-        for(int round = 0; round < 1000; round++)
-        {
-            while(true)
-            {
-                auto size = a;
-                size = (a + b) % 31;
-                b = a;
-                a = size;
-                size *= sizeMult;
-
-                CHECK(idx < sizeof(ptrs)/sizeof(*ptrs));
-
-                uint32_t actual;
-                if(auto x = uut.allocate(size, actual))
-                {
-                    CHECK(size <= actual && actual < pet::max(2 * size, 4 + 1));
-                    ptrs[idx++] = x;
-                }
-                else
-                {
-                    break;
-                }
-            }
-
-            for(int i = 1; i < idx; i++)
-                for(int j = 0; j < i; j++)
-                    CHECK(ptrs[i] != ptrs[j]);
-
-            const auto nFree = idx / 2;
-            for(int i = 0; i < nFree; i++)
-                uut.free(ptrs[--idx]);
-        }
+    TEST_SETUP() {
+        CHECK(uut.init(mem, mem + sizeof(mem) / sizeof(mem[0]), offlineTree, sizeof(offlineTree)));
     }
 };
 
-TEST(BuddyInline, Abuse)
+TEST(LazyBuddy, CachedBlockReused)
 {
-    CHECK(decltype(uut)::minimalTreeSize(1) == -1);
-
-    CHECK(!uut.init(mem, mem));
-    CHECK(!uut.init(mem, mem - size));
-
-    CHECK(!uut.init(mem, mem + 1, nullptr, 0));
-    CHECK(!uut.init(mem, mem + size, nullptr, 0));
-    CHECK(uut.init(mem, mem + size));
-    uut.free(nullptr);
-
-    CHECK(!uut.allocate(10000000));
-
-    auto x = uut.allocate(1);
-    CHECK(x);
-    CHECK(!uut.adjust(x, 100000000));
-    CHECK(uut.adjust(x, 1));
-}
+    auto x = uut.allocate(16);
+    auto y = uut.allocate(16);
 
-TEST(BuddyInline, Sanity)
-{
-    CHECK(uut.init(mem, mem + size));
+    uut.free(x);
+    CHECK(uut.getCachedCount() == 1);
 
-    auto x = uut.allocate(1);
-    CHECK(x);
+    CHECK(uut.allocate(16) == x);
+    CHECK(uut.getCachedCount() == 0);
 
+    uut.free(y);
     uut.free(x);
-}
+    CHECK(uut.getCachedCount() == 2);
 
-TEST(BuddyInline, AllSmallsSteppingShuffle)
-{
-    CHECK(uut.init(mem, mem + size));
-    steppingShuffle(1);
+    CHECK(uut.allocate(16) == x);
+    CHECK(uut.allocate(16) == y);
 }
 
-TEST(BuddyInline, AllBiggerSteppingShuffle)
+TEST(LazyBuddy, Watermark)
 {
-    CHECK(uut.init(mem, mem + size));
-    steppingShuffle(8);
-}
+    void* ptrs[2 * watermark + 1];
 
-TEST(BuddyInline, PassBigger)
-{
-    for(int small = 4; small < 8; small <<= 1)
+    for(auto &p: ptrs)
+        CHECK(p = uut.allocate(4));
+
+    for(auto p: ptrs)
     {
-        for(int big = 8; big <16; big <<= 1)
-        {
-            CHECK(uut.init(mem, mem + size));
-            CHECK(uut.allocate(small));
-            CHECK(uut.allocate(big));
-            CHECK(uut.allocate(small));
-            CHECK(uut.allocate(small));
-        }
+        uut.free(p);
+        CHECK(uut.getCachedCount() <= watermark);
     }
 }
 
-TEST(BuddyInline, RandomStress)
+TEST(LazyBuddy, CoalesceOnDemand)
 {
-    CHECK(uut.init(mem, mem + size));
-    runRandomStress();
-}
+    void* ptrs[sizeof(mem) / 64];
 
-TEST(BuddyInline, RandomStressOffline)
-{
-    char offlineTree[16];
-    CHECK(uut.init(mem, mem + size, offlineTree, sizeof(offlineTree)));
-    runRandomStress();
-}
+    for(auto &p: ptrs)
+        CHECK(p = uut.allocate(64));
 
-TEST(BuddyInline, AllocateAllOffline)
-{
-    char offlineTree[16];
+    CHECK(!uut.allocate(64));
 
-    auto minTree = decltype(uut)::minimalTreeSize(sizeof(mem));
-    CHECK(sizeof(offlineTree) > minTree);
-    CHECK(!uut.init(mem, mem + size, offlineTree, minTree - 1));
-    CHECK(uut.init(mem, mem + size, offlineTree, minTree));
+    for(auto p: ptrs)
+        uut.free(p);
 
-    auto x = uut.allocate(sizeof(mem));
-    CHECK(x);
-    CHECK(!uut.allocate(1));
-    uut.free(x);
-    CHECK(uut.allocate(size));
-}
-
-TEST(BuddyInline, RandomStressOfflineBigData)
-{
-    char bigData[16 * 1024];
-    char offlineTree[2050];
+    CHECK(uut.getCachedCount() > 0);
 
-    auto minTree = decltype(uut)::minimalTreeSize(sizeof(bigData));
-    CHECK(sizeof(offlineTree) > minTree);
-    CHECK(!uut.init(bigData, bigData + sizeof(bigData), offlineTree, minTree - 1));
-    CHECK(uut.init(bigData, bigData + sizeof(bigData), offlineTree, minTree));
-
-    for(int i = minTree; i < sizeof(offlineTree); i++)
-        offlineTree[i] ^= 0xaa;
-
-    runRandomStress();
+    auto all = uut.allocate(sizeof(mem));
+    CHECK(all);
+    CHECK(uut.getCachedCount() == 0);
 }
 
-TEST(BuddyInline, Grow)
+TEST(LazyBuddy, OtherOrderFromCache)
 {
-    CHECK(uut.init(mem, mem + size));
-    auto x = uut.allocate(4);
-    auto y = uut.allocate(4);
-    auto z = uut.allocate(4);
-    CHECK(!uut.adjust(x, 8));
-    CHECK(!uut.adjust(y, 8));
-    CHECK(uut.adjust(z, 8));
+    void* ptrs[sizeof(mem) / 32];
 
-    uut.free(y);
-    CHECK(uut.adjust(x, 8));
-    CHECK(!uut.adjust(x, 32));
+    for(auto &p: ptrs)
+        CHECK(p = uut.allocate(32));
 
-    uut.free(z);
-    CHECK(uut.adjust(x, 32));
+    CHECK(!uut.allocate(16));
 
-    uut.free(x);
+    // The lowest blocks of the full arena make up two buddy pairs.
+    std::sort(ptrs, ptrs + sizeof(ptrs) / sizeof(ptrs[0]));
 
-    CHECK(uut.allocate(32));
-    CHECK(uut.allocate(16));
-    CHECK(uut.allocate(8));
-    CHECK(!uut.allocate(1));
-}
+    for(int i = 0; i < watermark; i++)
+        uut.free(ptrs[i]);
 
-TEST(BuddyInline, Shrink)
-{
-    CHECK(uut.init(mem, mem + size));
-    auto x = uut.allocate(32);
-    auto y = uut.allocate(16);
-    auto z = uut.allocate(8);
-    CHECK(!uut.allocate(1));
+    CHECK(uut.getCachedCount() == watermark);
 
-    CHECK(uut.adjust(x, 4));
-
-    auto t = uut.allocate(4);
-    auto u = uut.allocate(8);
-    auto v = uut.allocate(16);
-    CHECK(!uut.allocate(1));
-
-    uut.free(x);
-    uut.free(y);
-    uut.free(z);
-    uut.free(t);
-    uut.free(u);
-    uut.free(v);
-
-    CHECK(uut.allocate(32));
+    // Nothing is left outside of the cache, so these must split and coalesce cached blocks.
     CHECK(uut.allocate(16));
-    CHECK(uut.allocate(8));
-    CHECK(!uut.allocate(1));
+    CHECK(uut.allocate(64));
+    CHECK(!uut.allocate(64));
 }
 
-TEST(BuddyInline, GrowAndShrink)
-{
-    CHECK(uut.init(mem, mem + size));
-    auto x = uut.allocate(16);
-    CHECK(uut.adjust(x, 32));
-
-    auto y = uut.allocate(8);
-
-    CHECK(uut.adjust(x, 16));
-
-    auto z = uut.allocate(16);
-
-    CHECK(!uut.adjust(x, 32));
-    uut.free(z);
-
-    CHECK(uut.adjust(x, 32));
-
-    uut.free(x);
-    uut.free(y);
-    CHECK(uut.allocate(32));
-    CHECK(uut.allocate(16));
-    CHECK(uut.allocate(8));
-    CHECK(!uut.allocate(1));
-}
+#endif
@@ -0,0 +1,180 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "heap/ConcurrentBuddy.h"
+
+#include "1test/Test.h"
+
+#include <atomic>
+#include <thread>
+
+TEST_GROUP(ConcurrentBuddy)
+{
+    static constexpr auto unitBits = 4u;
+    static constexpr auto nUnits = 16u * 1024u;
+    static constexpr auto maxThreads = 16u;
+
+    using Allocator = pet::ConcurrentBuddyAllocator<unitBits, 2>;
+
+    alignas(1 << unitBits) char data[nUnits << unitBits];
+    char tree[16 * 1024];
+
+    /*
+     * Owner of each allocation unit, claimed with a CAS on allocation and
+     * released before the block is freed. A failed claim means that two
+     * callers got overlapping blocks.
+     */
+    std::atomic<uint8_t> owner[nUnits];
+
+    Allocator uut;
+
+    TEST_SETUP()
+    {
+        auto minTree = Allocator::minimalTreeSize(sizeof(data));
+        CHECK(0 < minTree && minTree <= sizeof(tree));
+        CHECK(uut.init(data, data + sizeof(data), tree, minTree));
+
+        for(auto &o: owner)
+            o = 0;
+    }
+
+    bool claim(void* ptr, uint32_t size, uint8_t id)
+    {
+        const auto first = ((char*)ptr - data) >> unitBits;
+        const auto n = (size + (1 << unitBits) - 1) >> unitBits;
+
+        for(auto i = first; i < first + n; i++)
+        {
+            uint8_t expected = 0;
+            if(!owner[i].compare_exchange_strong(expected, id))
+                return false;
+        }
+
+        return true;
+    }
+
+    void release(void* ptr, uint32_t size)
+    {
+        const auto first = ((char*)ptr - data) >> unitBits;
+        const auto n = (size + (1 << unitBits) - 1) >> unitBits;
+
+        for(auto i = first; i < first + n; i++)
+            owner[i] = 0;
+    }
+
+    /*
+     * Multi-threaded version of the randomized stress run of the
+     * single threaded suite, each thread using its own size sequence.
+     */
+    bool runRandomStress(uint8_t id, unsigned int rounds)
+    {
+        void* ptrs[256];
+        uint32_t sizes[256];
+        unsigned int idx = 0, a = id, b = 1;
+        bool ok = true;
+
+        for(unsigned int round = 0; round < rounds; round++)
+        {
+            while(idx < sizeof(ptrs) / sizeof(ptrs[0]))
+            {
+                auto size = (a + b) % 31;
+                b = a;
+                a = size;
+
+                uint32_t actual;
+                if(auto x = uut.allocate(size << unitBits, actual))
+                {
+                    ok = claim(x, actual, id) && ok;
+                    ptrs[idx] = x;
+                    sizes[idx++] = actual;
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+            for(auto nFree = idx / 2; nFree; nFree--)
+            {
+                idx--;
+                release(ptrs[idx], sizes[idx]);
+                uut.free(ptrs[idx]);
+            }
+        }
+
+        while(idx--)
+        {
+            release(ptrs[idx], sizes[idx]);
+            uut.free(ptrs[idx]);
+        }
+
+        return ok;
+    }
+
+    void runThreads(unsigned int nThreads, unsigned int rounds)
+    {
+        std::thread threads[maxThreads];
+        bool results[maxThreads];
+
+        for(unsigned int i = 0; i < nThreads; i++)
+        {
+            threads[i] = std::thread([this, &results, i, rounds](){
+                results[i] = runRandomStress(uint8_t(i + 1), rounds);
+            });
+        }
+
+        for(unsigned int i = 0; i < nThreads; i++)
+            threads[i].join();
+
+        for(unsigned int i = 0; i < nThreads; i++)
+            CHECK(results[i]);
+
+        auto all = uut.allocate(sizeof(data));
+        CHECK(all);
+        uut.free(all);
+    }
+};
+
+TEST(ConcurrentBuddy, Sanity)
+{
+    auto x = uut.allocate(1);
+    CHECK(x);
+
+    uut.free(x);
+
+    CHECK(uut.allocate(sizeof(data)));
+    CHECK(!uut.allocate(1));
+}
+
+TEST(ConcurrentBuddy, InlineTreeRejected)
+{
+    Allocator other;
+    CHECK(!other.init(data, data + sizeof(data)));
+}
+
+TEST(ConcurrentBuddy, SingleThreaded)
+{
+    CHECK(runRandomStress(1, 1000));
+    CHECK(uut.allocate(sizeof(data)));
+}
+
+TEST(ConcurrentBuddy, NoOverlap)
+{
+    runThreads(maxThreads, 1000);
+}
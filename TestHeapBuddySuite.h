@@ -0,0 +1,361 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#ifndef HEAPBUDDYSUITE_H_
+#define HEAPBUDDYSUITE_H_
+
+#include "algorithm/Math.h"
+
+#include "1test/Test.h"
+
+template<class Allocator>
+struct BuddyTest
+{
+    static constexpr auto size = 16;
+
+    TEST_GROUP(BuddyInline)
+    {
+        uint32_t mem[size];
+
+        Allocator uut;
+
+        bool isUnique(void** ptrs, size_t n)
+        {
+            for(int i = 1; i < n; i++)
+            {
+                for(int j = 0; j < i; j++)
+                {
+                    if(ptrs[i] == ptrs[j])
+                        return false;
+                }
+            }
+
+            return true;
+        }
+
+        void steppingShuffle(int size)
+        {
+            void* ptrs[1024], **p = ptrs;
+
+            do {
+                *p = uut.allocate(size);
+            } while(*p++);
+
+            CHECK(isUnique(ptrs, p - ptrs));
+
+            for(int n = 1; n < p - ptrs; n++)
+            {
+                CHECK(!uut.allocate(size));
+
+                for(int i = 0; i < n; i++)
+                    uut.free(ptrs[i]);
+
+                for(int i = 0; i < n; i++) {
+                    ptrs[i] = uut.allocate(size);
+                    CHECK(ptrs[i]);
+                }
+
+                CHECK(isUnique(ptrs, p - ptrs));
+            }
+        }
+
+        void runRandomStress(uint32_t sizeMult = 1)
+        {
+            void* ptrs[1024];
+            int idx = 0;
+            int a = 1, b = 1;
+
+            for(int round = 0; round < 1000; round++)
+            {
+                while(true)
+                {
+                    auto size = a;
+                    size = (a + b) % 31;
+                    b = a;
+                    a = size;
+                    size *= sizeMult;
+
+                    CHECK(idx < sizeof(ptrs)/sizeof(*ptrs));
+
+                    uint32_t actual;
+                    if(auto x = uut.allocate(size, actual))
+                    {
+                        CHECK(size <= actual && actual < pet::max(2 * size, 4 + 1));
+                        ptrs[idx++] = x;
+                    }
+                    else
+                    {
+                        break;
+                    }
+                }
+
+                for(int i = 1; i < idx; i++)
+                    for(int j = 0; j < i; j++)
+                        CHECK(ptrs[i] != ptrs[j]);
+
+                const auto nFree = idx / 2;
+                for(int i = 0; i < nFree; i++)
+                    uut.free(ptrs[--idx]);
+            }
+        }
+    };
+
+    BEGIN_TEST_CASE(BuddyInline, Abuse)
+    {
+        CHECK(Allocator::minimalTreeSize(1) == -1);
+
+        CHECK(!this->uut.init(this->mem, this->mem));
+        CHECK(!this->uut.init(this->mem, this->mem - size));
+
+        CHECK(!this->uut.init(this->mem, this->mem + 1, nullptr, 0));
+        CHECK(!this->uut.init(this->mem, this->mem + size, nullptr, 0));
+        CHECK(this->uut.init(this->mem, this->mem + size));
+        this->uut.free(nullptr);
+
+        CHECK(!this->uut.allocate(10000000));
+
+        auto x = this->uut.allocate(1);
+        CHECK(x);
+        CHECK(!this->uut.adjust(x, 100000000));
+        CHECK(this->uut.adjust(x, 1));
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(BuddyInline, Sanity)
+    {
+        CHECK(this->uut.init(this->mem, this->mem + size));
+
+        auto x = this->uut.allocate(1);
+        CHECK(x);
+
+        this->uut.free(x);
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(BuddyInline, AllSmallsSteppingShuffle)
+    {
+        CHECK(this->uut.init(this->mem, this->mem + size));
+        this->steppingShuffle(1);
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(BuddyInline, AllBiggerSteppingShuffle)
+    {
+        CHECK(this->uut.init(this->mem, this->mem + size));
+        this->steppingShuffle(8);
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(BuddyInline, PassBigger)
+    {
+        for(int small = 4; small < 8; small <<= 1)
+        {
+            for(int big = 8; big <16; big <<= 1)
+            {
+                CHECK(this->uut.init(this->mem, this->mem + size));
+                CHECK(this->uut.allocate(small));
+                CHECK(this->uut.allocate(big));
+                CHECK(this->uut.allocate(small));
+                CHECK(this->uut.allocate(small));
+            }
+        }
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(BuddyInline, RandomStress)
+    {
+        CHECK(this->uut.init(this->mem, this->mem + size));
+        this->runRandomStress();
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(BuddyInline, RandomStressOffline)
+    {
+        char offlineTree[16];
+        CHECK(this->uut.init(this->mem, this->mem + size, offlineTree, sizeof(offlineTree)));
+        this->runRandomStress();
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(BuddyInline, AllocateAllOffline)
+    {
+        char offlineTree[16];
+
+        auto minTree = Allocator::minimalTreeSize(sizeof(this->mem));
+        CHECK(sizeof(offlineTree) > minTree);
+        CHECK(!this->uut.init(this->mem, this->mem + size, offlineTree, minTree - 1));
+        CHECK(this->uut.init(this->mem, this->mem + size, offlineTree, minTree));
+
+        auto x = this->uut.allocate(sizeof(this->mem));
+        CHECK(x);
+        CHECK(!this->uut.allocate(1));
+        this->uut.free(x);
+        CHECK(this->uut.allocate(size));
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(BuddyInline, RandomStressOfflineBigData)
+    {
+        char bigData[16 * 1024];
+        char offlineTree[2050];
+
+        auto minTree = Allocator::minimalTreeSize(sizeof(bigData));
+        CHECK(sizeof(offlineTree) > minTree);
+        CHECK(!this->uut.init(bigData, bigData + sizeof(bigData), offlineTree, minTree - 1));
+        CHECK(this->uut.init(bigData, bigData + sizeof(bigData), offlineTree, minTree));
+
+        for(int i = minTree; i < sizeof(offlineTree); i++)
+            offlineTree[i] ^= 0xaa;
+
+        this->runRandomStress();
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(BuddyInline, Grow)
+    {
+        CHECK(this->uut.init(this->mem, this->mem + size));
+        auto x = this->uut.allocate(4);
+        auto y = this->uut.allocate(4);
+        auto z = this->uut.allocate(4);
+        CHECK(!this->uut.adjust(x, 8));
+        CHECK(!this->uut.adjust(y, 8));
+        CHECK(this->uut.adjust(z, 8));
+
+        this->uut.free(y);
+        CHECK(this->uut.adjust(x, 8));
+        CHECK(!this->uut.adjust(x, 32));
+
+        this->uut.free(z);
+        CHECK(this->uut.adjust(x, 32));
+
+        this->uut.free(x);
+
+        CHECK(this->uut.allocate(32));
+        CHECK(this->uut.allocate(16));
+        CHECK(this->uut.allocate(8));
+        CHECK(!this->uut.allocate(1));
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(BuddyInline, Shrink)
+    {
+        CHECK(this->uut.init(this->mem, this->mem + size));
+        auto x = this->uut.allocate(32);
+        auto y = this->uut.allocate(16);
+        auto z = this->uut.allocate(8);
+        CHECK(!this->uut.allocate(1));
+
+        CHECK(this->uut.adjust(x, 4));
+
+        auto t = this->uut.allocate(4);
+        auto u = this->uut.allocate(8);
+        auto v = this->uut.allocate(16);
+        CHECK(!this->uut.allocate(1));
+
+        this->uut.free(x);
+        this->uut.free(y);
+        this->uut.free(z);
+        this->uut.free(t);
+        this->uut.free(u);
+        this->uut.free(v);
+
+        CHECK(this->uut.allocate(32));
+        CHECK(this->uut.allocate(16));
+        CHECK(this->uut.allocate(8));
+        CHECK(!this->uut.allocate(1));
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(BuddyInline, GrowAndShrink)
+    {
+        CHECK(this->uut.init(this->mem, this->mem + size));
+        auto x = this->uut.allocate(16);
+        CHECK(this->uut.adjust(x, 32));
+
+        auto y = this->uut.allocate(8);
+
+        CHECK(this->uut.adjust(x, 16));
+
+        auto z = this->uut.allocate(16);
+
+        CHECK(!this->uut.adjust(x, 32));
+        this->uut.free(z);
+
+        CHECK(this->uut.adjust(x, 32));
+
+        this->uut.free(x);
+        this->uut.free(y);
+        CHECK(this->uut.allocate(32));
+        CHECK(this->uut.allocate(16));
+        CHECK(this->uut.allocate(8));
+        CHECK(!this->uut.allocate(1));
+    }
+    END_TEST_CASE()
+
+#ifdef HEAP_EXTENSIONS
+    BEGIN_TEST_CASE(BuddyInline, AllocAligned)
+    {
+        alignas(64) uint32_t aligned[size];
+        char offlineTree[16];
+
+        CHECK(this->uut.init(aligned, aligned + size, offlineTree, sizeof(offlineTree)));
+
+        auto x = this->uut.allocate(4);
+        CHECK(x == aligned);
+
+        auto y = this->uut.allocAligned(4, 32);
+        CHECK(y && !((uintptr_t)y & 31));
+
+        auto z = this->uut.allocAligned(8, 16);
+        CHECK(z && !((uintptr_t)z & 15));
+
+        CHECK(x != y && y != z && z != x);
+
+        CHECK(!this->uut.allocAligned(4, 3));
+
+        this->uut.free(x);
+        this->uut.free(y);
+        this->uut.free(z);
+
+        CHECK(this->uut.allocate(sizeof(aligned)));
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(BuddyInline, AllocAlignedMisalignedArena)
+    {
+        alignas(64) uint32_t aligned[size + 1];
+        char offlineTree[16];
+        auto start = aligned + 1;
+
+        CHECK(this->uut.init(start, start + size, offlineTree, sizeof(offlineTree)));
+
+        auto x = this->uut.allocAligned(4, 32);
+        CHECK(x && !((uintptr_t)x & 31));
+
+        CHECK(!this->uut.allocAligned(16, 32));
+
+        this->uut.free(x);
+
+        CHECK(this->uut.allocate(size * sizeof(uint32_t)));
+    }
+    END_TEST_CASE()
+#endif
+};
+
+#endif /* HEAPBUDDYSUITE_H_ */
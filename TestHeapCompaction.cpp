@@ -0,0 +1,201 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/RelocatableHeap.h"
+
+#include <cstring>
+
+using namespace pet;
+
+using TestHeap = RelocatableHeap<TlsfHeap<uint32_t, 2, true>, 64>;
+
+TEST_GROUP(RelocatableHeap)
+{
+    struct Uut: TestHeap
+    {
+        uint32_t data[8 * 1024 / sizeof(uint32_t)];
+        Uut(): TestHeap(data, sizeof(data)) {}
+    };
+
+    Uut uut;
+
+    static constexpr unsigned int blockSize = 100;
+
+    TestHeap::Handle handles[64];
+
+    void fill(TestHeap::Handle h, uint8_t pattern)
+    {
+        memset(uut.pin(h), pattern, blockSize);
+        uut.unpin(h);
+    }
+
+    bool check(TestHeap::Handle h, uint8_t pattern)
+    {
+        auto p = (uint8_t*)uut.pin(h);
+        bool ok = true;
+
+        for(unsigned int i = 0; i < blockSize; i++)
+        {
+            if(p[i] != pattern)
+            {
+                ok = false;
+                break;
+            }
+        }
+
+        uut.unpin(h);
+        return ok;
+    }
+
+    /*
+     * Fills the arena with small blocks and then frees every second one, leaving
+     * plenty of free space all of which is in pieces too small to be useful.
+     */
+    unsigned int fragment()
+    {
+        unsigned int n = 0;
+
+        while(n < sizeof(handles) / sizeof(handles[0]))
+        {
+            if((handles[n] = uut.alloc(blockSize)) == TestHeap::invalid)
+                break;
+
+            fill(handles[n], uint8_t(n + 1));
+            n++;
+        }
+
+        for(unsigned int i = 0; i < n; i += 2)
+            uut.free(handles[i]);
+
+        return n;
+    }
+
+    unsigned int compactFully(unsigned int budget)
+    {
+        unsigned int nSlices = 1;
+
+        while(!uut.compact(budget))
+            nSlices++;
+
+        return nSlices;
+    }
+};
+
+TEST(RelocatableHeap, AllocPinFree)
+{
+    auto h = uut.alloc(blockSize);
+    CHECK(h != TestHeap::invalid);
+
+    fill(h, 0x5a);
+    CHECK(check(h, 0x5a));
+
+    uut.free(h);
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(RelocatableHeap, HandleTableExhaustion)
+{
+    for(auto &h: handles)
+        CHECK((h = uut.alloc(8)) != TestHeap::invalid);
+
+    CHECK(uut.alloc(8) == TestHeap::invalid);
+
+    uut.free(handles[10]);
+    CHECK((handles[10] = uut.alloc(8)) != TestHeap::invalid);
+
+    for(auto h: handles)
+        uut.free(h);
+
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(RelocatableHeap, CompactionRecoversLongestFree)
+{
+    const auto n = fragment();
+    CHECK(n > 8);
+
+    const auto before = uut.getStats();
+    CHECK(before.longestFree < before.totalFree / 2);
+
+    compactFully(1024);
+
+    const auto after = uut.getStats();
+    CHECK(after.nUsed == before.nUsed);
+    CHECK(after.totalFree >= before.totalFree);
+    CHECK(after.longestFree > before.totalFree / 2);
+
+    for(unsigned int i = 1; i < n; i += 2)
+        CHECK(check(handles[i], uint8_t(i + 1)));
+
+    auto big = uut.alloc(before.totalFree / 2);
+    CHECK(big != TestHeap::invalid);
+    uut.free(big);
+
+    for(unsigned int i = 1; i < n; i += 2)
+        uut.free(handles[i]);
+
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(RelocatableHeap, CompactionIsIncremental)
+{
+    const auto n = fragment();
+
+    const auto nSlices = compactFully(2 * blockSize);
+    CHECK(nSlices >= n / 2 / 2);
+
+    for(unsigned int i = 1; i < n; i += 2)
+    {
+        CHECK(check(handles[i], uint8_t(i + 1)));
+        uut.free(handles[i]);
+    }
+
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(RelocatableHeap, PinnedBlocksStay)
+{
+    const auto n = fragment();
+
+    const auto pinned = handles[n / 2 | 1];
+    auto p = uut.pin(pinned);
+
+    compactFully(1024);
+
+    CHECK(uut.pin(pinned) == p);
+    uut.unpin(pinned);
+    uut.unpin(pinned);
+
+    for(unsigned int i = 1; i < n; i += 2)
+    {
+        CHECK(check(handles[i], uint8_t(i + 1)));
+        uut.free(handles[i]);
+    }
+
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(RelocatableHeap, CompactEmpty)
+{
+    CHECK(uut.compact(1024));
+    CHECK(uut.getStats().nUsed == 0);
+}
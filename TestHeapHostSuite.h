@@ -22,6 +22,8 @@
 #include "1test/Test.h"
 #include "1test/Mock.h"
 
+#include "TestHeapStats.h"
+
 #include <set>
 #include <vector>
 #include <algorithm>
@@ -84,6 +86,21 @@ public:
     void update(unsigned int size, typename Base::Block block) {
         MOCK(HeapPolicy)::CALL(update);
     }
+
+    unsigned int getLongestFree() const
+    {
+        unsigned int ret = 0;
+
+        for(const auto &b: freeBlocks)
+        {
+            if(b.getSize() > ret)
+            {
+                ret = b.getSize();
+            }
+        }
+
+        return ret;
+    }
 };
 
 template<class SizeType, unsigned int alignmentBits, unsigned int spare, bool useChecksum, bool hot>
@@ -116,8 +133,13 @@ struct HeapTest
             return ret;
         }
 
-        auto stats() {
-            return this->heap->getStats((char*)this->heap->start);
+        auto stats()
+        {
+            auto walked = this->heap->getStats((char*)this->heap->start);
+#ifdef HEAP_EXTENSIONS
+            CHECK(countersMatchWalk(walked, this->heap->getStats()));
+#endif
+            return walked;
         }
 
         bool checkStatsEmpty()
@@ -718,6 +740,345 @@ struct HeapTest
     }
     END_TEST_CASE()
 
+#ifdef HEAP_EXTENSIONS
+    BEGIN_TEST_CASE(HeapHost, ReallocateShrink)
+    {
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        auto r = this->alloc(1000);
+        CHECK(r);
+
+        CHECK(this->checkStatsOneFree(1000, 1));
+
+        MOCK(HeapPolicy)::disable();
+
+        auto r2 = this->heap->reallocate(r, 100);
+        CHECK(r == r2);
+
+        MOCK(HeapPolicy)::enable();
+
+        CHECK(this->checkStatsOneFree(100, 1) || this->checkStatsMultipleFree(100, 1));
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(HeapHost, ReallocateGrowIntoEnd)
+    {
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        auto r = (char*)this->alloc(100);
+        CHECK(r);
+
+        memset(r, 0x5a, 100);
+
+        CHECK(this->checkStatsOneFree(100, 1));
+
+        MOCK(HeapPolicy)::EXPECT(remove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        auto r2 = (char*)this->heap->reallocate(r, 1000);
+        CHECK(r == r2);
+
+        for(int i = 0; i < 100; i++)
+            CHECK(r2[i] == 0x5a);
+
+        CHECK(this->checkStatsOneFree(1000, 1));
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(HeapHost, ReallocateGrowMergeNext)
+    {
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        auto r = this->alloc(100);
+        CHECK(r);
+
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        auto r2 = this->alloc(100);
+        CHECK(r2);
+
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        auto r3 = this->alloc(100);
+        CHECK(r3);
+
+        CHECK(this->checkStatsOneFree(3 * 100, 3));
+
+        MOCK(HeapPolicy)::EXPECT(add);
+        this->heap->free(r2);
+
+        CHECK(this->checkStatsMultipleFree(2 * 100, 2));
+
+        MOCK(HeapPolicy)::EXPECT(remove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        auto r4 = this->heap->reallocate(r, 150);
+        CHECK(r == r4);
+
+        CHECK(this->checkStatsMultipleFree(150 + 100, 2));
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(HeapHost, ReallocateMove)
+    {
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        auto r = (char*)this->alloc(100);
+        CHECK(r);
+
+        memset(r, 0x5a, 100);
+
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        auto r2 = this->alloc(10);
+        CHECK(r2);
+
+        CHECK(this->checkStatsOneFree(100 + 10, 2));
+
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        MOCK(HeapPolicy)::EXPECT(add);
+        auto r3 = (char*)this->heap->reallocate(r, 200);
+        CHECK(r3 && r3 != r);
+
+        for(int i = 0; i < 100; i++)
+            CHECK(r3[i] == 0x5a);
+
+        CHECK(this->checkStatsMultipleFree(200 + 10, 2));
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(HeapHost, ReallocateFails)
+    {
+        auto s = this->stats();
+
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        auto r = (char*)this->alloc(s.longestFree);
+        CHECK(r);
+
+        memset(r, 0x5a, s.longestFree);
+
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        CHECK(this->heap->reallocate(r, s.longestFree + 100) == nullptr);
+
+        for(int i = 0; i < s.longestFree; i++)
+            CHECK(r[i] == 0x5a);
+
+        CHECK(this->checkStatsFull(s.longestFree, 1));
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(HeapHost, AllocAligned)
+    {
+        MOCK(HeapPolicy)::disable();
+
+        for(uintptr_t alignment = 1u << alignmentBits; alignment <= 64; alignment <<= 1)
+        {
+            auto r = this->heap->allocAligned(100, alignment);
+            CHECK(r);
+            CHECK(!((uintptr_t)r & (alignment - 1)));
+
+            CHECK(this->checkStatsOneFree(100, 1) || this->checkStatsMultipleFree(100, 1));
+
+            this->heap->free(r);
+
+            CHECK(this->checkStatsEmpty());
+        }
+
+        MOCK(HeapPolicy)::enable();
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(HeapHost, AllocAlignedSlackReused)
+    {
+        MOCK(HeapPolicy)::disable();
+
+        auto r = this->heap->allocAligned(100, 256);
+        CHECK(r);
+        CHECK(!((uintptr_t)r & 255));
+
+        auto stats = this->stats();
+        CHECK(stats.nUsed == 1 && stats.totalUsed < 100 + 256);
+
+        if(r >= (char*)this->heap->start + 64)
+        {
+            auto r2 = this->alloc(4);
+            CHECK(r2 < r);
+            this->heap->free(r2);
+        }
+
+        this->heap->free(r);
+
+        MOCK(HeapPolicy)::enable();
+
+        CHECK(this->checkStatsEmpty());
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(HeapHost, AllocAlignedFails)
+    {
+        MOCK(HeapPolicy)::disable();
+
+        CHECK(!this->heap->allocAligned(100, 3 << alignmentBits));
+        CHECK(!this->heap->allocAligned(this->heap->size, 64));
+
+        // Whether a 4096 aligned block fits depends on where the arena ended up.
+        const auto start = (uintptr_t)this->heap->start;
+        const auto aligned = (start + 4095) & ~(uintptr_t)4095;
+
+        if(aligned + 100 > start + Uut::size)
+        {
+            CHECK(!this->heap->allocAligned(100, 4096));
+        }
+        else if(auto r = this->heap->allocAligned(100, 4096))
+        {
+            CHECK((uintptr_t)r == aligned);
+            this->heap->free(r);
+        }
+
+        MOCK(HeapPolicy)::enable();
+
+        CHECK(this->checkStatsEmpty());
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(HeapHost, AllocBatch)
+    {
+        void* ptrs[8];
+
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        CHECK(this->heap->allocBatch(8, 16, ptrs) == 8);
+
+        for(int i = 0; i < 8; i++)
+        {
+            CHECK(ptrs[i]);
+            CHECK(!(((uintptr_t)ptrs[i]) & ~(-1u << alignmentBits)));
+
+            // Carved from a single free block in address order, FreeBatchSeparateRuns relies on it.
+            if(i)
+                CHECK(ptrs[i - 1] < ptrs[i]);
+        }
+
+        CHECK(this->checkStatsOneFree(8 * 16, 8));
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(HeapHost, AllocBatchPartial)
+    {
+        void* ptrs[256];
+
+        MOCK(HeapPolicy)::disable();
+
+        const auto n = this->heap->allocBatch(256, 64, ptrs);
+        CHECK(0 < n && n < 256);
+
+        MOCK(HeapPolicy)::enable();
+
+        auto stats = this->stats();
+        CHECK(stats.nUsed == n && stats.longestFree < 64);
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(HeapHost, FreeBatchSingleRun)
+    {
+        void* ptrs[8];
+
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        CHECK(this->heap->allocBatch(8, 16, ptrs) == 8);
+
+        std::swap(ptrs[0], ptrs[5]);
+        std::swap(ptrs[2], ptrs[7]);
+
+        if(hot)
+        {
+            MOCK(HeapPolicy)::EXPECT(remove);
+            MOCK(HeapPolicy)::EXPECT(add);
+        }
+        else
+        {
+            MOCK(HeapPolicy)::EXPECT(update);
+        }
+
+        this->heap->freeBatch(ptrs, 8);
+
+        CHECK(this->checkStatsEmpty());
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(HeapHost, FreeBatchSeparateRuns)
+    {
+        void* ptrs[8];
+
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        CHECK(this->heap->allocBatch(8, 16, ptrs) == 8);
+
+        void* toFree[] = {ptrs[6], ptrs[1], ptrs[4], ptrs[0], ptrs[5], ptrs[2]};
+
+        MOCK(HeapPolicy)::EXPECT(add);
+        MOCK(HeapPolicy)::EXPECT(add);
+        this->heap->freeBatch(toFree, sizeof(toFree) / sizeof(toFree[0]));
+
+        CHECK(this->checkStatsMultipleFree(2 * 16, 2));
+
+        void* rest[] = {ptrs[3], ptrs[7]};
+
+        MOCK(HeapPolicy)::disable();
+        this->heap->freeBatch(rest, 2);
+        MOCK(HeapPolicy)::enable();
+
+        CHECK(this->checkStatsEmpty());
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(HeapHost, AddRegion)
+    {
+        uint32_t region[512 / sizeof(uint32_t)];
+
+        auto s = this->stats();
+
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        auto r = this->alloc(s.longestFree);
+        CHECK(r);
+
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        this->alloc(100, true);
+
+        MOCK(HeapPolicy)::EXPECT(add);
+        CHECK(this->heap->addRegion(region, sizeof(region)));
+
+        MOCK(HeapPolicy)::EXPECT(findAndRemove);
+        MOCK(HeapPolicy)::EXPECT(add);
+        auto r2 = this->alloc(100);
+        CHECK((char*)region <= r2 && r2 < (char*)region + sizeof(region));
+
+        auto counted = this->heap->getStats();
+        CHECK(counted.nUsed == 2 && counted.totalFree < sizeof(region) - 100);
+
+        MOCK(HeapPolicy)::disable();
+
+        this->heap->free(r);
+        this->heap->free(r2);
+
+        MOCK(HeapPolicy)::enable();
+
+        counted = this->heap->getStats();
+        CHECK(counted.nUsed == 0);
+        CHECK(counted.longestFree == s.longestFree);
+        CHECK(counted.longestFree < counted.totalFree);
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(HeapHost, AddRegionTooSmall)
+    {
+        uint32_t region[1];
+
+        CHECK(!this->heap->addRegion(region, sizeof(region)));
+        CHECK(this->checkStatsEmpty());
+    }
+    END_TEST_CASE()
+#endif
+
     BEGIN_TEST_CASE(HeapHost, DropHalfNoPrev)
     {
         MOCK(HeapPolicy)::EXPECT(findAndRemove);
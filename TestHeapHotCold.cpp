@@ -0,0 +1,173 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/HotColdHeap.h"
+
+#include <cstring>
+
+using namespace pet;
+
+using BaseHeap = TlsfHeap<uint32_t, 2, true>;
+using TestHeap = HotColdHeap<BaseHeap, 4 * 1024>;
+
+TEST_GROUP(HotColdHeap)
+{
+    static constexpr unsigned int arenaSize = 32 * 1024;
+
+    struct Uut: TestHeap
+    {
+        uint32_t data[arenaSize / sizeof(uint32_t)];
+        Uut(): TestHeap(data, sizeof(data)) {}
+    };
+
+    Uut uut;
+
+    bool isHot(void* ptr) {
+        return (char*)uut.data <= (char*)ptr && (char*)ptr < (char*)uut.data + 4 * 1024;
+    }
+};
+
+TEST(HotColdHeap, Routing)
+{
+    auto h = uut.alloc(100, true);
+    auto c = uut.alloc(100, false);
+    CHECK(h && c);
+
+    CHECK(isHot(h));
+    CHECK(!isHot(c));
+
+    uut.free(h);
+    uut.free(c);
+
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(HotColdHeap, PerArenaStats)
+{
+    void* hot[5];
+    void* cold[3];
+
+    for(auto &p: hot)
+        CHECK(p = uut.alloc(64, true));
+
+    for(auto &p: cold)
+        CHECK(p = uut.alloc(256, false));
+
+    auto h = uut.getHotStats();
+    auto c = uut.getColdStats();
+    auto t = uut.getStats();
+
+    CHECK(h.nUsed == 5 && h.totalUsed >= 5 * 64);
+    CHECK(c.nUsed == 3 && c.totalUsed >= 3 * 256);
+    CHECK(t.nUsed == h.nUsed + c.nUsed);
+    CHECK(t.totalUsed == h.totalUsed + c.totalUsed);
+    CHECK(t.totalFree == h.totalFree + c.totalFree);
+    CHECK(h.totalUsed + h.totalFree < 4 * 1024);
+
+    for(auto p: hot)
+        uut.free(p);
+
+    CHECK(uut.getHotStats().nUsed == 0);
+    CHECK(uut.getColdStats().nUsed == 3);
+
+    for(auto p: cold)
+        uut.free(p);
+
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(HotColdHeap, HotSpillsToCold)
+{
+    void* ptrs[64];
+    unsigned int n = 0, nSpilled = 0;
+
+    while(n < sizeof(ptrs) / sizeof(ptrs[0]))
+    {
+        if(!(ptrs[n] = uut.alloc(256, true)))
+            break;
+
+        if(!isHot(ptrs[n++]))
+            nSpilled++;
+    }
+
+    CHECK(n == sizeof(ptrs) / sizeof(ptrs[0]));
+    CHECK(nSpilled > 0);
+    CHECK(uut.getColdStats().nUsed == nSpilled);
+
+    for(unsigned int i = 0; i < n; i++)
+        uut.free(ptrs[i]);
+
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(HotColdHeap, ColdNotFragmentedByHotChurn)
+{
+    void* cold[16];
+    void* hot[16];
+
+    for(int i = 0; i < 16; i++)
+    {
+        CHECK(cold[i] = uut.alloc(512, false));
+        CHECK(hot[i] = uut.alloc(128, true));
+    }
+
+    for(auto p: hot)
+        uut.free(p);
+
+    auto c = uut.getColdStats();
+    CHECK(c.longestFree == c.totalFree);
+
+    auto h = uut.getHotStats();
+    CHECK(h.nUsed == 0 && h.longestFree == h.totalFree);
+
+    for(auto p: cold)
+        uut.free(p);
+
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(HotColdHeap, MixedLifetimesFragmentSharedArena)
+{
+    struct Shared: BaseHeap
+    {
+        uint32_t data[arenaSize / sizeof(uint32_t)];
+        Shared(): BaseHeap(data, sizeof(data)) {}
+    } shared;
+
+    void* cold[16];
+    void* hot[16];
+
+    for(int i = 0; i < 16; i++)
+    {
+        CHECK(cold[i] = shared.alloc(512, false));
+        CHECK(hot[i] = shared.alloc(128, true));
+    }
+
+    for(auto p: hot)
+        shared.free(p);
+
+    auto s = shared.getStats();
+    CHECK(s.longestFree < s.totalFree);
+
+    for(auto p: cold)
+        shared.free(p);
+}
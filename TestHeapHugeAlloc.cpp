@@ -0,0 +1,162 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/HugeMapping.h"
+
+#include <cstring>
+
+#include <unistd.h>
+
+using namespace pet;
+
+TEST_GROUP(HugeMapping)
+{
+    static constexpr auto threshold = 64 * 1024;
+    using Heap = pet::HugeMapping<TlsfHeap<uint32_t, 2, true>, threshold>;
+
+    struct Uut: Heap
+    {
+        uint32_t data[128 * 1024 / sizeof(uint32_t)];
+        Uut(): Heap(data, sizeof(data)) {}
+
+        bool inArena(void* p) {
+            return (char*)data <= (char*)p && (char*)p < (char*)data + sizeof(data);
+        }
+    };
+
+    Uut uut;
+
+    const unsigned int pageSize = sysconf(_SC_PAGESIZE);
+};
+
+TEST(HugeMapping, SmallFromArena)
+{
+    auto p = uut.alloc(threshold - 1);
+    CHECK(p && uut.inArena(p));
+
+    auto s = uut.getStats();
+    CHECK(s.nUsed == 1 && s.nHuge == 0 && s.totalHuge == 0);
+
+    uut.free(p);
+
+    s = uut.getStats();
+    CHECK(s.nUsed == 0 && s.nHuge == 0);
+}
+
+TEST(HugeMapping, HugeMapped)
+{
+    auto p = uut.alloc(threshold);
+    CHECK(p && !uut.inArena(p));
+
+    memset(p, 0x5a, threshold);
+
+    auto s = uut.getStats();
+    CHECK(s.nUsed == 0 && s.totalUsed == 0);
+    CHECK(s.nHuge == 1 && s.totalHuge >= threshold && s.totalHuge < threshold + 2 * pageSize);
+
+    uut.free(p);
+
+    s = uut.getStats();
+    CHECK(s.nHuge == 0 && s.totalHuge == 0);
+}
+
+TEST(HugeMapping, LargerThanArena)
+{
+    auto p = uut.alloc(16 * sizeof(Uut::data));
+    CHECK(p);
+
+    memset(p, 0x5a, 16 * sizeof(Uut::data));
+
+    uut.free(p);
+}
+
+TEST(HugeMapping, GrowHuge)
+{
+    auto p = (char*)uut.alloc(threshold);
+    memset(p, 0x5a, threshold);
+
+    auto q = (char*)uut.reallocate(p, 16 * threshold);
+    CHECK(q);
+
+    for(int i = 0; i < threshold; i++)
+        CHECK(q[i] == 0x5a);
+
+    memset(q, 0xa5, 16 * threshold);
+
+    auto s = uut.getStats();
+    CHECK(s.nHuge == 1 && s.totalHuge >= 16 * threshold);
+
+    uut.free(q);
+
+    CHECK(uut.getStats().totalHuge == 0);
+}
+
+TEST(HugeMapping, ShrinkHuge)
+{
+    auto p = uut.alloc(4 * threshold);
+
+    auto n = uut.resize(p, 2 * threshold);
+    CHECK(2 * threshold <= n && n < 2 * threshold + pageSize);
+
+    auto s = uut.getStats();
+    CHECK(s.totalHuge >= 2 * threshold && s.totalHuge < 3 * threshold);
+
+    uut.free(p);
+}
+
+TEST(HugeMapping, GrowFromArena)
+{
+    auto p = (char*)uut.alloc(1024);
+    memset(p, 0x5a, 1024);
+
+    auto q = (char*)uut.reallocate(p, 2 * threshold);
+    CHECK(q && !uut.inArena(q));
+
+    for(int i = 0; i < 1024; i++)
+        CHECK(q[i] == 0x5a);
+
+    auto s = uut.getStats();
+    CHECK(s.nUsed == 0 && s.nHuge == 1);
+
+    uut.free(q);
+}
+
+TEST(HugeMapping, ArenaStaysDense)
+{
+    void* small[16];
+    void* huge[16];
+
+    for(int i = 0; i < 16; i++)
+    {
+        CHECK(small[i] = uut.alloc(1024));
+        CHECK(huge[i] = uut.alloc(threshold));
+    }
+
+    for(auto p: huge)
+        uut.free(p);
+
+    auto s = uut.getStats();
+    CHECK(s.nUsed == 16 && s.longestFree == s.totalFree);
+
+    for(auto p: small)
+        uut.free(p);
+}
@@ -0,0 +1,177 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/Buddy.h"
+
+#include <type_traits>
+#include <utility>
+
+using namespace pet;
+
+using PlainHeap = Heap<TlsfPolicy<uint32_t>, uint32_t, 2, true>;
+using InstrumentedHeap = Heap<TlsfPolicy<uint32_t>, uint32_t, 2, true, true>;
+
+/*
+ * The disabled variant must not carry the instrumentation at all.
+ */
+template<class T, class = void>
+struct HasInstrumentation: std::false_type {};
+
+template<class T>
+struct HasInstrumentation<T, std::void_t<decltype(std::declval<T&>().getInstrumentation())>>: std::true_type {};
+
+static_assert(!HasInstrumentation<PlainHeap>::value);
+static_assert(HasInstrumentation<InstrumentedHeap>::value);
+static_assert(sizeof(InstrumentedHeap) > sizeof(PlainHeap));
+
+static_assert(!HasInstrumentation<BuddyAllocator<2, 2>>::value);
+static_assert(HasInstrumentation<BuddyAllocator<2, 2, true>>::value);
+static_assert(sizeof(BuddyAllocator<2, 2, true>) > sizeof(BuddyAllocator<2, 2>));
+
+template<size_t n>
+static inline unsigned int sum(const uint32_t (&buckets)[n])
+{
+    unsigned int ret = 0;
+
+    for(auto b: buckets)
+        ret += b;
+
+    return ret;
+}
+
+TEST_GROUP(HeapInstrumentation)
+{
+    struct Uut: InstrumentedHeap
+    {
+        uint32_t data[16 * 1024 / sizeof(uint32_t)];
+        Uut(): InstrumentedHeap(data, sizeof(data)) {}
+    };
+
+    Uut uut;
+};
+
+TEST(HeapInstrumentation, Empty)
+{
+    auto s = uut.getInstrumentation();
+
+    CHECK(sum(s.sizes) == 0);
+    CHECK(sum(s.allocCycles) == 0);
+    CHECK(sum(s.freeCycles) == 0);
+    CHECK(sum(s.searchLengths) == 0);
+    CHECK(s.splits == 0 && s.merges == 0);
+}
+
+TEST(HeapInstrumentation, SizeHistogram)
+{
+    for(auto size: {1, 2, 3, 4, 100, 1000, 1023, 1024})
+        CHECK(uut.alloc(size));
+
+    auto s = uut.getInstrumentation();
+
+    CHECK(s.sizes[0] == 1);
+    CHECK(s.sizes[1] == 2);
+    CHECK(s.sizes[2] == 1);
+    CHECK(s.sizes[6] == 1);
+    CHECK(s.sizes[9] == 2);
+    CHECK(s.sizes[10] == 1);
+    CHECK(sum(s.sizes) == 8);
+}
+
+TEST(HeapInstrumentation, OversizedClamped)
+{
+    CHECK(!uut.alloc(-1u));
+
+    auto s = uut.getInstrumentation();
+    CHECK(s.sizes[Uut::Snapshot::nBuckets - 1] == 1);
+}
+
+TEST(HeapInstrumentation, OperationCounts)
+{
+    void* ptrs[10];
+
+    for(auto &p: ptrs)
+        CHECK(p = uut.alloc(100));
+
+    for(int i = 0; i < 5; i++)
+        uut.free(ptrs[i]);
+
+    auto s = uut.getInstrumentation();
+    CHECK(sum(s.allocCycles) == 10);
+    CHECK(sum(s.freeCycles) == 5);
+    CHECK(sum(s.searchLengths) == 10);
+}
+
+TEST(HeapInstrumentation, SplitMerge)
+{
+    auto a = uut.alloc(100);
+    auto b = uut.alloc(100);
+
+    auto s = uut.getInstrumentation();
+    CHECK(s.splits == 2 && s.merges == 0);
+
+    uut.free(a);
+
+    s = uut.getInstrumentation();
+    CHECK(s.splits == 2 && s.merges == 0);
+
+    uut.free(b);
+
+    s = uut.getInstrumentation();
+    CHECK(s.splits == 2 && s.merges == 2);
+}
+
+TEST(HeapInstrumentation, Reset)
+{
+    uut.free(uut.alloc(100));
+    uut.resetInstrumentation();
+
+    auto s = uut.getInstrumentation();
+    CHECK(sum(s.sizes) == 0);
+    CHECK(sum(s.allocCycles) == 0);
+    CHECK(sum(s.freeCycles) == 0);
+    CHECK(s.splits == 0 && s.merges == 0);
+}
+
+TEST_GROUP(BuddyInstrumentation)
+{
+    uint32_t mem[256];
+    char offlineTree[256];
+    BuddyAllocator<2, 2, true> uut;
+};
+
+TEST(BuddyInstrumentation, SplitMerge)
+{
+    CHECK(uut.init(mem, mem + 256, offlineTree, sizeof(offlineTree)));
+
+    auto x = uut.allocate(sizeof(mem) / 4);
+
+    auto s = uut.getInstrumentation();
+    CHECK(s.splits == 2 && s.merges == 0);
+    CHECK(s.sizes[8] == 1);
+    CHECK(sum(s.allocCycles) == 1);
+
+    uut.free(x);
+
+    s = uut.getInstrumentation();
+    CHECK(s.splits == 2 && s.merges == 2);
+    CHECK(sum(s.freeCycles) == 1);
+}
@@ -0,0 +1,168 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/LockFreePool.h"
+
+#include "managed/RefCnt.h"
+#include "managed/Unique.h"
+
+#include <thread>
+#include <cstring>
+
+using namespace pet;
+
+TEST_GROUP(LockFreePool)
+{
+    struct Tag;
+    static constexpr auto slotSize = 32;
+    static constexpr auto nSlots = 16;
+    using Uut = pet::LockFreePool<slotSize, nSlots, Tag>;
+};
+
+TEST(LockFreePool, Sanity)
+{
+    auto p = Uut::alloc(slotSize);
+    CHECK(p);
+
+    Uut::free(p);
+    CHECK(Uut::allFreed());
+}
+
+TEST(LockFreePool, Deplete)
+{
+    void* ptrs[nSlots];
+
+    for(auto &p: ptrs)
+        CHECK(p = Uut::alloc(1));
+
+    CHECK(!Uut::alloc(1));
+
+    for(int i = 1; i < nSlots; i++)
+        for(int j = 0; j < i; j++)
+            CHECK(ptrs[i] != ptrs[j]);
+
+    for(auto p: ptrs)
+        Uut::free(p);
+
+    CHECK(Uut::allFreed());
+}
+
+TEST(LockFreePool, OversizedFails)
+{
+    CHECK(!Uut::alloc(slotSize + 1));
+    CHECK(Uut::allFreed());
+}
+
+TEST(LockFreePool, LastFreedFirstReused)
+{
+    auto p = Uut::alloc(slotSize);
+    auto q = Uut::alloc(slotSize);
+
+    Uut::free(p);
+    Uut::free(q);
+
+    CHECK(Uut::alloc(slotSize) == q);
+    CHECK(Uut::alloc(slotSize) == p);
+
+    Uut::free(p);
+    Uut::free(q);
+    CHECK(Uut::allFreed());
+}
+
+TEST(LockFreePool, Shrink)
+{
+    auto p = Uut::alloc(slotSize);
+    CHECK(Uut::shrink(p, 1) == slotSize);
+
+    Uut::free(p);
+    CHECK(Uut::allFreed());
+}
+
+TEST(LockFreePool, Managed)
+{
+    struct Counted: RefCnt<Counted, Uut>
+    {
+        int x;
+        inline Counted(int x): x(x) {}
+    };
+
+    struct Single: Unique<Single, Uut>
+    {
+        int x;
+        inline Single(int x): x(x) {}
+    };
+
+    {
+        auto a = Counted::make(1);
+        auto b = a;
+        auto c = Single::make(2);
+
+        CHECK(a->x == 1 && b->x == 1 && c->x == 2);
+    }
+
+    CHECK(Uut::allFreed());
+}
+
+/*
+ * Threads keep grabbing and releasing slots as fast as they can,
+ * tagging every slot while they own it. The ABA-tagged head must
+ * never let two threads own the same slot at the same time.
+ */
+TEST(LockFreePool, Concurrent)
+{
+    static constexpr auto nThreads = 8;
+    std::thread threads[nThreads];
+    bool results[nThreads];
+
+    for(int i = 0; i < nThreads; i++)
+    {
+        threads[i] = std::thread([&results, i]()
+        {
+            bool ok = true;
+
+            for(int n = 0; n < 100000; n++)
+            {
+                if(auto p = (volatile uint8_t*)Uut::alloc(slotSize))
+                {
+                    for(int j = 0; j < slotSize; j++)
+                        p[j] = i;
+
+                    std::this_thread::yield();
+
+                    for(int j = 0; j < slotSize; j++)
+                        ok = ok && p[j] == i;
+
+                    Uut::free((void*)p);
+                }
+            }
+
+            results[i] = ok;
+        });
+    }
+
+    for(auto &t: threads)
+        t.join();
+
+    for(auto r: results)
+        CHECK(r);
+
+    CHECK(Uut::allFreed());
+}
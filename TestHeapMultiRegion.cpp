@@ -0,0 +1,161 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/MmapGrowth.h"
+
+#include <cstring>
+
+using namespace pet;
+
+using TestHeap = TlsfHeap<uint32_t, 2, true>;
+
+TEST_GROUP(MultiRegionHeap)
+{
+    struct Uut: TestHeap
+    {
+        uint32_t data[4 * 1024 / sizeof(uint32_t)];
+        Uut(): TestHeap(data, sizeof(data)) {}
+    };
+
+    Uut uut;
+
+    static inline uint32_t spare[4][4 * 1024 / sizeof(uint32_t)];
+    static inline unsigned int nGrowths, lastRequest;
+
+    static bool growFromSpare(TestHeap& heap, unsigned int size)
+    {
+        lastRequest = size;
+
+        if(nGrowths < sizeof(spare) / sizeof(spare[0]))
+        {
+            return heap.addRegion(spare[nGrowths++], sizeof(spare[0]));
+        }
+
+        return false;
+    }
+
+    TEST_SETUP() {
+        nGrowths = 0;
+    }
+};
+
+TEST(MultiRegionHeap, NoGrowthByDefault)
+{
+    while(uut.alloc(100));
+
+    CHECK(!uut.alloc(100));
+    CHECK(uut.getStats().nUsed > 0);
+}
+
+TEST(MultiRegionHeap, NoCrossRegionMerge)
+{
+    uint32_t other[1024 / sizeof(uint32_t)];
+
+    CHECK(uut.addRegion(other, sizeof(other)));
+
+    auto s = uut.getStats();
+    CHECK(s.longestFree < sizeof(uut.data));
+    CHECK(s.totalFree > sizeof(uut.data));
+
+    CHECK(!uut.alloc(sizeof(uut.data)));
+
+    auto p = uut.alloc(sizeof(other) / 2);
+    auto q = uut.alloc(sizeof(uut.data) / 2);
+    CHECK(p && q);
+
+    uut.free(p);
+    uut.free(q);
+
+    auto t = uut.getStats();
+    CHECK(t.nUsed == 0);
+    CHECK(t.longestFree == s.longestFree && t.totalFree == s.totalFree);
+}
+
+TEST(MultiRegionHeap, GrowthHook)
+{
+    uut.setGrowthHook(&growFromSpare);
+
+    void* ptrs[64];
+    int n = 0;
+
+    while(n < sizeof(ptrs) / sizeof(ptrs[0]))
+    {
+        if(!(ptrs[n] = uut.alloc(1000)))
+            break;
+
+        memset(ptrs[n++], 0x5a, 1000);
+    }
+
+    CHECK(nGrowths == 4);
+    CHECK(lastRequest >= 1000);
+    CHECK(n >= 4 * 3);
+
+    for(int i = 0; i < n; i++)
+        uut.free(ptrs[i]);
+
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(MultiRegionHeap, GrowthHookOnlyOnExhaustion)
+{
+    uut.setGrowthHook(&growFromSpare);
+
+    auto p = uut.alloc(100);
+    auto q = uut.alloc(3 * 1024);
+    CHECK(p && q);
+    CHECK(nGrowths == 0);
+
+    auto r = uut.alloc(2 * 1024);
+    CHECK(r);
+    CHECK(nGrowths == 1);
+    CHECK((char*)spare[0] <= r && r < (char*)spare[1]);
+
+    uut.free(p);
+    uut.free(q);
+    uut.free(r);
+
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(MultiRegionHeap, MmapGrowth)
+{
+    uut.setGrowthHook(&mmapGrowthHook<TestHeap, 64 * 1024>);
+
+    void* ptrs[256];
+
+    for(auto &p: ptrs)
+    {
+        CHECK(p = uut.alloc(1024));
+        memset(p, 0x5a, 1024);
+    }
+
+    auto big = uut.alloc(256 * 1024);
+    CHECK(big);
+    memset(big, 0xa5, 256 * 1024);
+
+    for(auto p: ptrs)
+        uut.free(p);
+
+    uut.free(big);
+
+    CHECK(uut.getStats().nUsed == 0);
+}
@@ -0,0 +1,235 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/PersistentHeap.h"
+
+#include <cstdlib>
+#include <cstdio>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace pet;
+
+using TestHeap = PersistentHeap<TlsfHeap<uint32_t, 2, true>>;
+
+TEST_GROUP(PersistentHeap)
+{
+    static constexpr unsigned int fileSize = 256 * 1024;
+    static constexpr unsigned int nNodes = 100;
+
+    struct Node
+    {
+        uint32_t next;
+        uint32_t value;
+    };
+
+    char path[32] = "/tmp/pet-heap-XXXXXX";
+
+    TEST_SETUP()
+    {
+        int fd = mkstemp(path);
+        CHECK(fd >= 0);
+        close(fd);
+        unlink(path);
+    }
+
+    TEST_TEARDOWN() {
+        unlink(path);
+    }
+
+    /*
+     * Does not CHECK, so that it can also be used in a forked child.
+     */
+    static bool build(TestHeap* heap)
+    {
+        uint32_t head = 0;
+
+        for(unsigned int i = 0; i < nNodes; i++)
+        {
+            auto n = (Node*)heap->alloc(sizeof(Node));
+
+            if(!n)
+                return false;
+
+            n->value = i;
+            n->next = head;
+            head = heap->offsetOf(n);
+        }
+
+        heap->setRoot(heap->fromOffset(head));
+        return true;
+    }
+
+    static bool verify(TestHeap* heap)
+    {
+        unsigned int count = 0;
+
+        for(auto n = (Node*)heap->getRoot(); n; n = n->next ? (Node*)heap->fromOffset(n->next) : nullptr)
+        {
+            if(n->value != nNodes - 1 - count++)
+                return false;
+        }
+
+        return count == nNodes;
+    }
+};
+
+TEST(PersistentHeap, Create)
+{
+    auto heap = TestHeap::open(path, fileSize);
+    CHECK(heap);
+    CHECK(heap->wasCleanlyClosed());
+    CHECK(heap->getRoot() == nullptr);
+    CHECK(heap->getStats().nUsed == 0);
+
+    TestHeap::close(heap);
+}
+
+TEST(PersistentHeap, ReopenAtDifferentAddress)
+{
+    auto heap = TestHeap::open(path, fileSize);
+    CHECK(heap);
+    CHECK(build(heap));
+    CHECK(verify(heap));
+
+    void* const oldAddress = heap;
+    TestHeap::close(heap);
+
+    void* placeholder = mmap(oldAddress, fileSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    CHECK(placeholder == oldAddress);
+
+    heap = TestHeap::open(path, fileSize);
+    CHECK(heap);
+    CHECK((void*)heap != oldAddress);
+    CHECK(heap->wasCleanlyClosed());
+    CHECK(verify(heap));
+    CHECK(heap->getStats().nUsed == nNodes);
+
+    TestHeap::close(heap);
+    munmap(placeholder, fileSize);
+}
+
+TEST(PersistentHeap, FreeAfterReopen)
+{
+    auto heap = TestHeap::open(path, fileSize);
+    CHECK(heap);
+    CHECK(build(heap));
+
+    void* const oldAddress = heap;
+    TestHeap::close(heap);
+
+    void* placeholder = mmap(oldAddress, fileSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    CHECK(placeholder == oldAddress);
+
+    heap = TestHeap::open(path, fileSize);
+    CHECK(heap);
+    CHECK((void*)heap != oldAddress);
+
+    // Drop every other node, the policy index has to be usable at the new address.
+    for(auto n = (Node*)heap->getRoot(); n && n->next;)
+    {
+        auto victim = (Node*)heap->fromOffset(n->next);
+        n->next = victim->next;
+        heap->free(victim);
+        n = n->next ? (Node*)heap->fromOffset(n->next) : nullptr;
+    }
+
+    CHECK(heap->getStats().nUsed == nNodes / 2);
+
+    auto head = heap->offsetOf(heap->getRoot());
+
+    for(unsigned int i = 0; i < nNodes / 2; i++)
+    {
+        auto n = (Node*)heap->alloc(sizeof(Node));
+        CHECK(n);
+
+        n->value = nNodes + i;
+        n->next = head;
+        head = heap->offsetOf(n);
+    }
+
+    heap->setRoot(heap->fromOffset(head));
+
+    unsigned int count = 0;
+
+    for(auto n = (Node*)heap->getRoot(); n; n = n->next ? (Node*)heap->fromOffset(n->next) : nullptr, count++)
+    {
+        if(count < nNodes / 2)
+            CHECK(n->value == nNodes + nNodes / 2 - 1 - count);
+        else
+            CHECK(n->value == nNodes - 1 - 2 * (count - nNodes / 2));
+    }
+
+    CHECK(count == nNodes);
+
+    for(auto n = (Node*)heap->getRoot(); n;)
+    {
+        auto next = n->next ? (Node*)heap->fromOffset(n->next) : nullptr;
+        heap->free(n);
+        n = next;
+    }
+
+    heap->setRoot(nullptr);
+
+    auto s = heap->getStats();
+    CHECK(s.nUsed == 0 && s.longestFree == s.totalFree);
+
+    TestHeap::close(heap);
+    munmap(placeholder, fileSize);
+}
+
+TEST(PersistentHeap, DirtyShutdownDetected)
+{
+    auto pid = fork();
+    CHECK(pid >= 0);
+
+    if(!pid)
+    {
+        auto heap = TestHeap::open(path, fileSize);
+        _exit(heap && build(heap) ? 0 : 1);
+    }
+
+    int status;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    auto heap = TestHeap::open(path, fileSize);
+    CHECK(heap);
+    CHECK(!heap->wasCleanlyClosed());
+
+    TestHeap::close(heap);
+
+    heap = TestHeap::open(path, fileSize);
+    CHECK(heap->wasCleanlyClosed());
+    TestHeap::close(heap);
+}
+
+TEST(PersistentHeap, SizeMismatchRejected)
+{
+    auto heap = TestHeap::open(path, fileSize);
+    CHECK(heap);
+    TestHeap::close(heap);
+
+    CHECK(TestHeap::open(path, 2 * fileSize) == nullptr);
+}
@@ -0,0 +1,195 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/Buddy.h"
+#include "heap/MemoryResource.h"
+
+#include "MockAllocator.h"
+
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+#include <map>
+
+using namespace pet;
+
+TEST_GROUP(HeapMemoryResource)
+{
+    using TestHeap = TlsfHeap<uint32_t, 2, true>;
+
+    struct Heap: TestHeap
+    {
+        uint32_t data[256 * 1024 / sizeof(uint32_t)];
+        Heap(): TestHeap(data, sizeof(data)) {}
+
+        auto stats() {
+            return this->getStats(data);
+        }
+    };
+
+    Heap heap;
+    pet::HeapMemoryResource<TestHeap> uut = pet::HeapMemoryResource<TestHeap>(heap);
+};
+
+TEST(HeapMemoryResource, Sanity)
+{
+    auto p = uut.allocate(100);
+    CHECK(p);
+    CHECK(heap.stats().nUsed == 1);
+
+    uut.deallocate(p, 100);
+    CHECK(heap.stats().nUsed == 0);
+}
+
+TEST(HeapMemoryResource, Alignment)
+{
+    for(size_t alignment = 1; alignment <= 256; alignment <<= 1)
+    {
+        auto p = uut.allocate(24, alignment);
+        CHECK(!((uintptr_t)p & (alignment - 1)));
+        uut.deallocate(p, 24, alignment);
+    }
+
+    CHECK(heap.stats().nUsed == 0);
+}
+
+TEST(HeapMemoryResource, Equality)
+{
+    pet::HeapMemoryResource<TestHeap> same(heap);
+    CHECK(uut.is_equal(same));
+    CHECK(!uut.is_equal(*std::pmr::new_delete_resource()));
+}
+
+TEST(HeapMemoryResource, Containers)
+{
+    {
+        std::pmr::vector<int> v(&uut);
+
+        for(int i = 0; i < 1000; i++)
+            v.push_back(i);
+
+        std::pmr::unordered_map<int, int> m(&uut);
+
+        for(int i = 0; i < 1000; i++)
+            m[i] = v[i];
+
+        for(int i = 0; i < 1000; i++)
+            CHECK(m[i] == i);
+
+        CHECK(heap.stats().nUsed > 1000);
+    }
+
+    CHECK(heap.stats().nUsed == 0);
+}
+
+TEST_GROUP(BuddyMemoryResource)
+{
+    using Buddy = BuddyAllocator<3, 2>;
+
+    uint64_t data[8 * 1024];
+    char tree[8 * 1024];
+    Buddy buddy;
+
+    TEST_SETUP() {
+        CHECK(buddy.init(data, data + sizeof(data) / sizeof(data[0]), tree, sizeof(tree)));
+    }
+};
+
+TEST(BuddyMemoryResource, Containers)
+{
+    pet::BuddyMemoryResource<Buddy> uut(buddy);
+
+    {
+        std::pmr::vector<long> v(&uut);
+
+        for(int i = 0; i < 1000; i++)
+            v.push_back(i);
+
+        std::pmr::map<int, long> m(&uut);
+
+        for(int i = 0; i < 100; i++)
+            m[i] = v[i];
+
+        for(int i = 0; i < 100; i++)
+            CHECK(m[i] == i);
+    }
+
+    CHECK(buddy.allocate(sizeof(data)));
+}
+
+TEST(BuddyMemoryResource, Alignment)
+{
+    pet::BuddyMemoryResource<Buddy> uut(buddy);
+
+    auto p = uut.allocate(8, 64);
+    CHECK(!((uintptr_t)p & 63));
+    uut.deallocate(p, 8, 64);
+
+    CHECK(buddy.allocate(sizeof(data)));
+}
+
+TEST_GROUP(StlAllocator) {};
+
+TEST(StlAllocator, Vector)
+{
+    {
+        std::vector<int, pet::StlAllocator<int, ::Allocator>> v;
+
+        for(int i = 0; i < 100; i++)
+            v.push_back(i);
+
+        CHECK(::Allocator::count == 1);
+
+        for(int i = 0; i < 100; i++)
+            CHECK(v[i] == i);
+    }
+
+    CHECK(::Allocator::allFreed());
+}
+
+TEST(StlAllocator, UnorderedMap)
+{
+    using Map = std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, pet::StlAllocator<std::pair<const int, int>, ::Allocator>>;
+
+    {
+        Map m;
+
+        for(int i = 0; i < 100; i++)
+            m[i] = -i;
+
+        CHECK(::Allocator::count > 100);
+
+        for(int i = 0; i < 100; i++)
+            CHECK(m[i] == -i);
+    }
+
+    CHECK(::Allocator::allFreed());
+}
+
+TEST(StlAllocator, Rebind)
+{
+    using A = pet::StlAllocator<int, ::Allocator>;
+    using B = std::allocator_traits<A>::rebind_alloc<double>;
+
+    static_assert(std::is_same_v<B, pet::StlAllocator<double, ::Allocator>>);
+    CHECK(A() == B());
+}
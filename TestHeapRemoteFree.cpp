@@ -0,0 +1,198 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/RemoteFree.h"
+
+#include <atomic>
+#include <thread>
+#include <cstring>
+
+using namespace pet;
+
+TEST_GROUP(RemoteFree)
+{
+    using Arena = RemoteFreeArena<TlsfHeap<uint32_t, 2, true>>;
+
+    struct Uut: Arena
+    {
+        uint32_t data[64 * 1024 / sizeof(uint32_t)];
+        Uut(): Arena(data, sizeof(data)) {}
+
+        auto stats() {
+            return this->getStats(data);
+        }
+    };
+
+    Uut uut;
+
+    /*
+     * Single producer single consumer ring used to hand messages over.
+     */
+    struct Channel
+    {
+        static constexpr unsigned int size = 64;
+        void* slots[size];
+        std::atomic<unsigned int> head{0}, tail{0};
+
+        bool send(void* p)
+        {
+            const auto t = tail.load(std::memory_order_relaxed);
+
+            if(t - head.load(std::memory_order_acquire) == size)
+                return false;
+
+            slots[t % size] = p;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        void* receive()
+        {
+            const auto h = head.load(std::memory_order_relaxed);
+
+            if(h == tail.load(std::memory_order_acquire))
+                return nullptr;
+
+            auto ret = slots[h % size];
+            head.store(h + 1, std::memory_order_release);
+            return ret;
+        }
+    };
+};
+
+TEST(RemoteFree, LocalFree)
+{
+    auto p = uut.alloc(24);
+    CHECK(p);
+    CHECK(uut.owns(p));
+
+    uut.free(p);
+    CHECK(uut.stats().nUsed == 0);
+}
+
+TEST(RemoteFree, NotOwned)
+{
+    uint32_t other[4];
+    CHECK(!uut.owns(other));
+}
+
+TEST(RemoteFree, DrainedOnNextAlloc)
+{
+    auto p = uut.alloc(24);
+    auto q = uut.alloc(100);
+    CHECK(p && q);
+
+    bool freedP = false, freedQ = false;
+
+    std::thread([&](){
+        freedP = uut.remoteFree(p);
+        freedQ = uut.remoteFree(q);
+    }).join();
+
+    CHECK(freedP && freedQ);
+    CHECK(uut.stats().nUsed == 2);
+
+    auto r = uut.alloc(24);
+    CHECK(r);
+    CHECK(uut.stats().nUsed == 1);
+
+    uut.free(r);
+    CHECK(uut.stats().nUsed == 0);
+}
+
+TEST(RemoteFree, DuplicateRejected)
+{
+    auto p = uut.alloc(24);
+    CHECK(p);
+
+    CHECK(uut.remoteFree(p));
+    CHECK(!uut.remoteFree(p));
+
+    uut.drain();
+    CHECK(uut.stats().nUsed == 0);
+}
+
+TEST(RemoteFree, ExplicitDrain)
+{
+    void* ptrs[16];
+
+    for(auto &p: ptrs)
+        CHECK(p = uut.alloc(32));
+
+    for(auto p: ptrs)
+        CHECK(uut.remoteFree(p));
+
+    CHECK(uut.stats().nUsed == 16);
+    CHECK(uut.drain() == 16);
+    CHECK(uut.drain() == 0);
+
+    auto s = uut.stats();
+    CHECK(s.nUsed == 0 && s.longestFree == s.totalFree);
+}
+
+TEST(RemoteFree, ProducerConsumer)
+{
+    static constexpr unsigned int nMessages = 100000;
+
+    Channel channel;
+    std::atomic<bool> consumerOk{true};
+
+    std::thread consumer([&](){
+        for(unsigned int i = 0; i < nMessages;)
+        {
+            if(auto p = (uint32_t*)channel.receive())
+            {
+                if(*p != i)
+                    consumerOk = false;
+
+                if(!uut.remoteFree(p))
+                    consumerOk = false;
+
+                i++;
+            }
+        }
+    });
+
+    for(unsigned int i = 0; i < nMessages;)
+    {
+        auto p = (uint32_t*)uut.alloc(sizeof(uint32_t) + i % 64);
+
+        if(!p)
+        {
+            uut.drain();
+            continue;
+        }
+
+        *p = i;
+
+        while(!channel.send(p))
+            std::this_thread::yield();
+
+        i++;
+    }
+
+    consumer.join();
+    CHECK(consumerOk);
+
+    uut.drain();
+    CHECK(uut.stats().nUsed == 0);
+}
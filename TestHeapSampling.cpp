@@ -0,0 +1,202 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/Sampling.h"
+
+#include "MockAllocator.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace pet;
+
+using Profiler = AllocationProfiler<256, 32>;
+using TestHeap = SamplingHeap<TlsfHeap<uint32_t, 2, true>, Profiler>;
+using TestAllocator = SamplingAllocator<Allocator, Profiler>;
+
+/*
+ * Distinct call sites, not static so that -rdynamic exports their names.
+ */
+__attribute__((noinline)) void* sampledSiteBig(TestHeap& heap) {
+    return heap.alloc(192);
+}
+
+__attribute__((noinline)) void* sampledSiteSmall(TestHeap& heap) {
+    return heap.alloc(64);
+}
+
+TEST_GROUP(AllocationSampling)
+{
+    struct Uut: TestHeap
+    {
+        uint32_t data[64 * 1024 / sizeof(uint32_t)];
+        Uut(): TestHeap(data, sizeof(data)) {}
+    };
+
+    Profiler profiler;
+    Uut uut;
+
+    TEST_SETUP() {
+        profiler.setSeed(1234);
+        uut.setProfiler(&profiler);
+    }
+
+    /*
+     * Allocates and immediately frees the given number of blocks of the given size.
+     */
+    void churn(unsigned int n, unsigned int size)
+    {
+        for(unsigned int i = 0; i < n; i++)
+        {
+            auto p = uut.alloc(size);
+            CHECK(p);
+            uut.free(p);
+        }
+    }
+
+    std::string dump(void (Profiler::*method)(FILE*))
+    {
+        char* buffer = nullptr;
+        size_t length = 0;
+        FILE* f = open_memstream(&buffer, &length);
+        (profiler.*method)(f);
+        fclose(f);
+
+        std::string ret(buffer, length);
+        ::free(buffer);
+        return ret;
+    }
+
+    static unsigned long long weightOf(const std::string &folded, const char* frame)
+    {
+        unsigned long long ret = 0;
+
+        for(size_t start = 0, end; start < folded.size(); start = end + 1)
+        {
+            end = folded.find('\n', start);
+
+            if(end == std::string::npos)
+                end = folded.size();
+
+            const auto line = folded.substr(start, end - start);
+
+            if(line.find(frame) != std::string::npos)
+                ret += strtoull(line.c_str() + line.rfind(' ') + 1, nullptr, 10);
+        }
+
+        return ret;
+    }
+};
+
+TEST(AllocationSampling, Disabled)
+{
+    profiler.setInterval(0);
+    churn(10000, 64);
+
+    CHECK(profiler.getSampleCount() == 0);
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(AllocationSampling, EveryAllocationAtIntervalOne)
+{
+    profiler.setInterval(1);
+    churn(100, 64);
+
+    CHECK(profiler.getSampleCount() == 100);
+    CHECK(profiler.getSampledBytes() == 100 * 64);
+}
+
+TEST(AllocationSampling, PoissonRate)
+{
+    profiler.setInterval(4096);
+    churn(16384, 64);
+
+    // 1 MiB allocated with a mean spacing of 4 KiB gives 256 samples on average.
+    const auto n = profiler.getSampleCount();
+    CHECK(128 < n && n < 512);
+
+    // Samples are weighted by the inverse probability, so the estimate tracks the real volume.
+    const auto estimate = profiler.getEstimatedBytes();
+    CHECK(estimate > 1024 * 1024 / 2 && estimate < 2 * 1024 * 1024);
+}
+
+TEST(AllocationSampling, CallSiteAttribution)
+{
+    profiler.setInterval(1024);
+
+    for(int i = 0; i < 4096; i++)
+    {
+        uut.free(sampledSiteBig(uut));
+        uut.free(sampledSiteSmall(uut));
+    }
+
+    const auto folded = dump(&Profiler::dumpFolded);
+
+    const auto big = weightOf(folded, "sampledSiteBig");
+    const auto small = weightOf(folded, "sampledSiteSmall");
+
+    CHECK(big > 0 && small > 0);
+    CHECK(big > 2 * small);
+}
+
+TEST(AllocationSampling, PprofFormat)
+{
+    profiler.setInterval(1024);
+    churn(1024, 128);
+
+    const auto text = dump(&Profiler::dumpPprof);
+
+    CHECK(text.rfind("heap profile: ", 0) == 0);
+    CHECK(text.find(" @ 0x") != std::string::npos);
+    CHECK(text.find("MAPPED_LIBRARIES:") != std::string::npos);
+}
+
+TEST(AllocationSampling, Reset)
+{
+    profiler.setInterval(1);
+    churn(10, 64);
+    CHECK(profiler.getSampleCount() == 10);
+
+    profiler.reset();
+    CHECK(profiler.getSampleCount() == 0);
+    CHECK(dump(&Profiler::dumpFolded).empty());
+}
+
+TEST(AllocationSampling, Allocator)
+{
+    profiler.setInterval(1);
+    TestAllocator::setProfiler(&profiler);
+
+    auto p = TestAllocator::alloc(24);
+    auto q = TestAllocator::allocFor<uint64_t>();
+    CHECK(p && q);
+
+    TestAllocator::free(p);
+    TestAllocator::free(q);
+
+    TestAllocator::setProfiler(nullptr);
+
+    CHECK(profiler.getSampleCount() == 2);
+    CHECK(Allocator::allFreed());
+}
@@ -0,0 +1,184 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/Heap.h"
+#include "heap/SegregatedFitPolicy.h"
+
+using namespace pet;
+
+using Policy = SegregatedFitPolicy<uint32_t>;
+using TestHeap = Heap<Policy, uint32_t, 2>;
+
+class SegregatedFitInternalsTest: private TestHeap::Block
+{
+public:
+    using TestHeap::Block::headerSize;
+};
+
+TEST_GROUP(TestSegregatedFitHeap)
+{
+    struct Uut: HeapBase<uint32_t>
+    {
+        constexpr static unsigned int usedBlockHeaderSize = SegregatedFitInternalsTest::headerSize;
+        unsigned int data[256*256*8/sizeof(unsigned int)];
+        TestHeap heap;
+        Uut():heap(data, sizeof(data)) {}
+
+        void *alloc(unsigned int size, bool shouldFail = false)
+        {
+            auto ret = heap.alloc(size);
+            CHECK((ret == nullptr) == shouldFail);
+            return ret;
+        }
+
+        void checkEmpty()
+        {
+            auto s = heap.getStats(data);
+            CHECK(s.nUsed == 0 && s.totalUsed == 0);
+            CHECK(s.longestFree == s.totalFree);
+        }
+    };
+
+    Uut uut;
+};
+
+TEST(TestSegregatedFitHeap, AllocSanity)
+{
+    uut.heap.free(uut.alloc(1));
+    uut.checkEmpty();
+}
+
+TEST(TestSegregatedFitHeap, SmallExactFit)
+{
+    void *d[6];
+
+    d[0] = uut.alloc(64);
+    d[1] = uut.alloc(16);
+    d[2] = uut.alloc(48);
+    d[3] = uut.alloc(16);
+    d[4] = uut.alloc(80);
+    d[5] = uut.alloc(16);
+
+    uut.heap.free(d[0]);
+    uut.heap.free(d[2]);
+    uut.heap.free(d[4]);
+
+    auto before = uut.heap.getStats(uut.data);
+
+    CHECK(d[2] == uut.alloc(48));
+    CHECK(d[0] == uut.alloc(64));
+    CHECK(d[4] == uut.alloc(80));
+
+    auto after = uut.heap.getStats(uut.data);
+    CHECK(after.longestFree == before.longestFree);
+
+    for(auto p: d)
+        uut.heap.free(p);
+
+    uut.checkEmpty();
+}
+
+TEST(TestSegregatedFitHeap, EverySmallBin)
+{
+    void *d[512 / 4];
+    void *sep[512 / 4];
+
+    for(unsigned int i = 0; i < sizeof(d) / sizeof(d[0]); i++)
+    {
+        d[i] = uut.alloc((i + 1) * 4);
+        sep[i] = uut.alloc(4);
+    }
+
+    for(auto p: d)
+        uut.heap.free(p);
+
+    for(unsigned int i = sizeof(d) / sizeof(d[0]); i--;)
+        CHECK(d[i] == uut.alloc((i + 1) * 4));
+
+    for(unsigned int i = 0; i < sizeof(d) / sizeof(d[0]); i++)
+    {
+        uut.heap.free(d[i]);
+        uut.heap.free(sep[i]);
+    }
+
+    uut.checkEmpty();
+}
+
+TEST(TestSegregatedFitHeap, BinBoundary)
+{
+    void *d[4];
+
+    d[0] = uut.alloc(480);
+    d[1] = uut.alloc(16);
+    d[2] = uut.alloc(600);
+    d[3] = uut.alloc(16);
+
+    uut.heap.free(d[2]);
+    uut.heap.free(d[0]);
+
+    // An exact bin hit is preferred to the larger block in the range bins.
+    CHECK(d[0] == uut.alloc(480));
+    CHECK(d[2] == uut.alloc(520));
+
+    for(auto p: d)
+        uut.heap.free(p);
+
+    uut.checkEmpty();
+}
+
+TEST(TestSegregatedFitHeap, SmallFromLargeWhenBinsEmpty)
+{
+    void *rest[128];
+    unsigned int nRest = 0;
+
+    auto large = (char*)uut.alloc(1024);
+    auto separator = uut.alloc(16);
+
+    // Use up the rest of the arena, so the only free block will be the large one.
+    for(unsigned int size: {64 * 1024, 4 * 1024, 256, 16, 4})
+    {
+        while(nRest < sizeof(rest) / sizeof(rest[0]) && (rest[nRest] = uut.heap.alloc(size)))
+            nRest++;
+    }
+
+    CHECK(nRest < sizeof(rest) / sizeof(rest[0]));
+    CHECK(!uut.heap.alloc(4));
+
+    uut.heap.free(large);
+
+    auto p = (char*)uut.alloc(24);
+    CHECK(large <= p && p < large + 1024);
+
+    auto s = uut.heap.getStats(uut.data);
+    CHECK(s.totalFree > 0 && s.longestFree == s.totalFree && s.longestFree < 1024);
+
+    auto q = (char*)uut.alloc(32);
+    CHECK(large <= q && q < large + 1024);
+
+    uut.heap.free(p);
+    uut.heap.free(q);
+    uut.heap.free(separator);
+
+    for(unsigned int i = 0; i < nRest; i++)
+        uut.heap.free(rest[i]);
+
+    uut.checkEmpty();
+}
@@ -0,0 +1,293 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/Slab.h"
+
+#include "managed/RefCnt.h"
+#include "managed/Unique.h"
+
+#include <cstring>
+
+using namespace pet;
+
+using BackingHeap = TlsfHeap<uint32_t, 2, true>;
+using TestSlab = SlabAllocator<BackingHeap, 1024, 8, 16, 32, 64, 128>;
+
+TEST_GROUP(Slab)
+{
+    struct Backing: BackingHeap
+    {
+        uint32_t data[64 * 1024 / sizeof(uint32_t)];
+        Backing(): BackingHeap(data, sizeof(data)) {}
+
+        auto stats() {
+            return this->getStats(data);
+        }
+    };
+
+    Backing backing;
+    TestSlab uut = TestSlab(backing);
+};
+
+TEST(Slab, Sanity)
+{
+    auto p = uut.alloc(24);
+    CHECK(p);
+
+    CHECK(backing.stats().nUsed == 1);
+
+    uut.free(p);
+
+    CHECK(backing.stats().nUsed == 0);
+}
+
+TEST(Slab, NoHeader)
+{
+    auto p = (char*)uut.alloc(32);
+    auto q = (char*)uut.alloc(32);
+    auto r = (char*)uut.alloc(32);
+
+    CHECK(q - p == 32);
+    CHECK(r - q == 32);
+}
+
+TEST(Slab, RoundedToClass)
+{
+    auto p = (char*)uut.alloc(17);
+    auto q = (char*)uut.alloc(32);
+    CHECK(q - p == 32);
+
+    auto r = (char*)uut.alloc(1);
+    auto s = (char*)uut.alloc(8);
+    CHECK(s - r == 8);
+}
+
+TEST(Slab, PageGranularity)
+{
+    constexpr auto n = TestSlab::slotsPerPage(64);
+    CHECK(n > 1);
+
+    for(int i = 0; i < n; i++)
+        CHECK(uut.alloc(64));
+
+    CHECK(backing.stats().nUsed == 1);
+
+    CHECK(uut.alloc(64));
+
+    CHECK(backing.stats().nUsed == 2);
+}
+
+TEST(Slab, ClassesUseSeparatePages)
+{
+    CHECK(uut.alloc(8));
+    CHECK(uut.alloc(16));
+    CHECK(uut.alloc(128));
+
+    CHECK(backing.stats().nUsed == 3);
+}
+
+TEST(Slab, SlotReused)
+{
+    auto p = uut.alloc(16);
+    auto q = uut.alloc(16);
+
+    uut.free(p);
+    CHECK(uut.alloc(16) == p);
+
+    uut.free(q);
+    CHECK(uut.alloc(16) == q);
+}
+
+TEST(Slab, EmptyPageReleased)
+{
+    constexpr auto n = TestSlab::slotsPerPage(128) + 1;
+    void* ptrs[n];
+
+    for(auto &p: ptrs)
+        CHECK(p = uut.alloc(128));
+
+    CHECK(backing.stats().nUsed == 2);
+
+    uut.free(ptrs[n - 1]);
+
+    CHECK(backing.stats().nUsed == 1);
+
+    for(int i = 0; i < n - 1; i++)
+        uut.free(ptrs[i]);
+
+    CHECK(backing.stats().nUsed == 0);
+}
+
+TEST(Slab, OversizedFromBacking)
+{
+    auto p = uut.alloc(129);
+    CHECK(p);
+
+    auto s = backing.stats();
+    CHECK(s.nUsed == 1 && s.totalUsed >= 129 && s.totalUsed < 1024);
+
+    uut.free(p);
+
+    CHECK(backing.stats().nUsed == 0);
+}
+
+TEST(Slab, AllocFor)
+{
+    struct Small { char x[12]; };
+    struct Big { char x[100]; };
+
+    auto p = (char*)uut.allocFor<Small>();
+    auto q = (char*)uut.alloc(16);
+    CHECK(q - p == 16);
+
+    auto r = (char*)uut.allocFor<Big>();
+    auto s = (char*)uut.alloc(128);
+    CHECK(s - r == 128);
+}
+
+TEST(Slab, Shrink)
+{
+    auto p = uut.alloc(64);
+    CHECK(uut.shrink(p, 10) == 64);
+
+    auto q = uut.alloc(1000);
+    auto n = uut.shrink(q, 500);
+    CHECK(500 <= n && n < 1000);
+}
+
+TEST(Slab, Exhaustion)
+{
+    unsigned int count = 0;
+    void* last = nullptr;
+
+    while(auto p = uut.alloc(128))
+    {
+        last = p;
+        count++;
+    }
+
+    CHECK(count > 0);
+    CHECK(count > (sizeof(Backing::data) / 2) / 128);
+
+    uut.free(last);
+    CHECK(uut.alloc(128) == last);
+}
+
+TEST(Slab, RandomStress)
+{
+    static constexpr auto n = 256;
+    void* ptrs[n] = {nullptr, };
+    unsigned int sizes[n];
+    uint32_t state = 1234;
+
+    auto random = [&state](unsigned int l, unsigned int h) {
+        state = state * 1103515245 + 12345;
+        return l + ((state >> 16) % (h - l + 1));
+    };
+
+    for(int i = 0; i < 100000; i++)
+    {
+        const auto idx = random(0, n - 1);
+
+        if(ptrs[idx])
+        {
+            for(int j = 0; j < sizes[idx]; j++)
+                CHECK(((uint8_t*)ptrs[idx])[j] == uint8_t(idx));
+
+            uut.free(ptrs[idx]);
+            ptrs[idx] = nullptr;
+        }
+        else
+        {
+            sizes[idx] = random(1, 160);
+            CHECK(ptrs[idx] = uut.alloc(sizes[idx]));
+            memset(ptrs[idx], idx, sizes[idx]);
+        }
+    }
+
+    for(auto p: ptrs)
+        if(p)
+            uut.free(p);
+
+    CHECK(backing.stats().nUsed == 0);
+}
+
+TEST_GROUP(SlabManaged)
+{
+    struct Backing: BackingHeap
+    {
+        uint32_t data[16 * 1024 / sizeof(uint32_t)];
+        Backing(): BackingHeap(data, sizeof(data)) {}
+    };
+
+    static inline Backing backing;
+    static inline TestSlab slab = TestSlab(backing);
+
+    /*
+     * Static adapter exposing the slab instance through the
+     * interface expected by the managed pointers.
+     */
+    struct Allocator
+    {
+        static inline void* alloc(unsigned int s) { return slab.alloc(s); }
+        template<class T> static inline void* allocFor() { return slab.allocFor<T>(); }
+        static inline void free(void* p) { slab.free(p); }
+        static inline unsigned int shrink(void* p, unsigned int s) { return slab.shrink(p, s); }
+        static inline void traceReferenceAcquistion(void* refLoc, void* trg) {}
+        static inline void traceReferenceRelease(void* refLoc, void* trg) {}
+    };
+
+    struct Counted: RefCnt<Counted, Allocator>
+    {
+        int x;
+        inline Counted(int x): x(x) {}
+    };
+
+    struct Single: Unique<Single, Allocator>
+    {
+        int x;
+        inline Single(int x): x(x) {}
+    };
+};
+
+TEST(SlabManaged, RefCnt)
+{
+    {
+        auto a = Counted::make(1);
+        auto b = Counted::make(2);
+
+        CHECK(a->x == 1 && b->x == 2);
+        CHECK((char*)b.get() - (char*)a.get() == TestSlab::classOf(sizeof(Counted)));
+    }
+
+    CHECK(backing.getStats(backing.data).nUsed == 0);
+}
+
+TEST(SlabManaged, Unique)
+{
+    {
+        auto a = Single::make(1);
+        CHECK(a->x == 1);
+    }
+
+    CHECK(backing.getStats(backing.data).nUsed == 0);
+}
@@ -0,0 +1,215 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/Buddy.h"
+#include "heap/TlsfPolicy.h"
+#include "heap/SpanHeap.h"
+
+#include <cstring>
+#include <memory>
+
+using namespace pet;
+
+static constexpr unsigned int arenaSize = 256 * 1024;
+static constexpr unsigned int spanSize = 16 * 1024;
+static constexpr unsigned int nSpans = arenaSize / spanSize;
+
+using TestSpanHeap = pet::SpanHeap<BuddyAllocator<2, 2>, TlsfHeap<uint32_t, 2, true>, spanSize>;
+
+TEST_GROUP(SpanHeap)
+{
+    alignas(spanSize) static inline char data[arenaSize];
+    std::unique_ptr<char[]> tree;
+
+    TestSpanHeap uut;
+
+    TEST_SETUP()
+    {
+        // The buddy tree takes about a byte for every eight bytes of the arena.
+        const auto treeSize = TestSpanHeap::minimalTreeSize(arenaSize);
+        tree.reset(new char[treeSize]);
+        CHECK(uut.init(data, data + arenaSize, tree.get(), treeSize));
+    }
+
+    /*
+     * Allocates blocks of the given size until the arena runs out, returns the count.
+     */
+    unsigned int fill(void** ptrs, unsigned int max, unsigned int size)
+    {
+        unsigned int n = 0;
+
+        while(n < max)
+        {
+            if(!(ptrs[n] = uut.alloc(size)))
+                break;
+
+            memset(ptrs[n++], 0x5a, size);
+        }
+
+        return n;
+    }
+};
+
+TEST(SpanHeap, Sanity)
+{
+    CHECK(uut.getSpanCount() == 0);
+
+    auto p = uut.alloc(24);
+    CHECK(p);
+    CHECK(uut.getSpanCount() == 1);
+
+    auto q = uut.alloc(100);
+    CHECK(q);
+    CHECK(uut.getSpanCount() == 1);
+
+    uut.free(p);
+    CHECK(uut.getSpanCount() == 1);
+
+    uut.free(q);
+    CHECK(uut.getSpanCount() == 0);
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(SpanHeap, SpansCarvedOnDemand)
+{
+    void* ptrs[1024];
+    const auto n = fill(ptrs, 1024, 1000);
+
+    CHECK(n > 4 * (nSpans - 1) && n < 16 * nSpans);
+    CHECK(uut.getSpanCount() == nSpans);
+    CHECK(uut.getStats().nUsed == n);
+    CHECK(!uut.alloc(1000));
+
+    for(unsigned int i = 0; i < n; i++)
+        uut.free(ptrs[i]);
+
+    CHECK(uut.getSpanCount() == 0);
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(SpanHeap, EmptySpanReturned)
+{
+    void* ptrs[1024];
+    const auto n = fill(ptrs, 1024, 1000);
+    const auto perSpan = n / nSpans;
+
+    // Blocks are carved from spans in order, so the first few all come from the first span.
+    for(unsigned int i = 0; i < perSpan; i++)
+        uut.free(ptrs[i]);
+
+    CHECK(uut.getSpanCount() == nSpans - 1);
+
+    // The returned span can be carved again for a size the remaining ones can not serve.
+    auto big = uut.alloc(spanSize / 2);
+    CHECK(big);
+    CHECK(uut.getSpanCount() == nSpans);
+
+    uut.free(big);
+
+    for(unsigned int i = perSpan; i < n; i++)
+        uut.free(ptrs[i]);
+
+    CHECK(uut.getSpanCount() == 0);
+}
+
+TEST(SpanHeap, LargeFromBuddy)
+{
+    auto small = uut.alloc(64);
+    auto large = uut.alloc(4 * spanSize);
+    CHECK(small && large);
+
+    CHECK(uut.getSpanCount() == 1);
+    CHECK(((uintptr_t)large - (uintptr_t)data) % (4 * spanSize) == 0);
+
+    memset(large, 0xa5, 4 * spanSize);
+
+    uut.free(large);
+    uut.free(small);
+
+    CHECK(uut.getSpanCount() == 0);
+    CHECK(uut.getStats().nUsed == 0);
+}
+
+TEST(SpanHeap, MemoryMovesBetweenRegimes)
+{
+    void* ptrs[4096];
+
+    for(int round = 0; round < 3; round++)
+    {
+        const auto n = fill(ptrs, 4096, 48);
+        CHECK(n > 0);
+        CHECK(uut.getSpanCount() == nSpans);
+
+        for(unsigned int i = 0; i < n; i++)
+            uut.free(ptrs[i]);
+
+        CHECK(uut.getSpanCount() == 0);
+
+        auto whole = uut.alloc(arenaSize / 2);
+        CHECK(whole);
+        memset(whole, 0xa5, arenaSize / 2);
+
+        CHECK(!uut.alloc(arenaSize / 2 + 1));
+        uut.free(whole);
+    }
+}
+
+TEST(SpanHeap, RandomStress)
+{
+    void* ptrs[512] = {nullptr, };
+    unsigned int sizes[512];
+    uint32_t state = 1234;
+
+    auto random = [&](unsigned int l, unsigned int h) {
+        state = state * 1103515245 + 12345;
+        return l + ((state >> 16) % (h - l + 1));
+    };
+
+    for(int i = 0; i < 100000; i++)
+    {
+        const auto idx = random(0, 511);
+
+        if(ptrs[idx])
+        {
+            for(unsigned int j = 0; j < sizes[idx]; j++)
+                CHECK(((uint8_t*)ptrs[idx])[j] == uint8_t(idx));
+
+            uut.free(ptrs[idx]);
+            ptrs[idx] = nullptr;
+        }
+        else
+        {
+            sizes[idx] = random(0, 7) ? random(1, 512) : random(spanSize, 2 * spanSize);
+
+            if((ptrs[idx] = uut.alloc(sizes[idx])))
+                memset(ptrs[idx], uint8_t(idx), sizes[idx]);
+        }
+    }
+
+    for(auto p: ptrs)
+    {
+        if(p)
+            uut.free(p);
+    }
+
+    CHECK(uut.getSpanCount() == 0);
+    CHECK(uut.getStats().nUsed == 0);
+}
@@ -0,0 +1,36 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#ifndef HEAPSTATS_H_
+#define HEAPSTATS_H_
+
+/*
+ * Checks the statistics maintained incrementally by the heap against the ones
+ * gathered by walking all of its blocks.
+ */
+template<class Stats>
+static inline bool countersMatchWalk(const Stats &walked, const Stats &counted)
+{
+    return walked.nUsed == counted.nUsed
+        && walked.totalUsed == counted.totalUsed
+        && walked.totalFree == counted.totalFree
+        && walked.longestFree == counted.longestFree;
+}
+
+#endif /* HEAPSTATS_H_ */
@@ -22,6 +22,9 @@
 #include "heap/AvlTreePolicy.h"
 #include "heap/BestFitPolicy.h"
 #include "heap/TlsfPolicy.h"
+#ifdef HEAP_EXTENSIONS
+#include "heap/SegregatedFitPolicy.h"
+#endif
 
 #include "TestHeapStress.h"
 
@@ -30,7 +33,13 @@ using namespace pet;
 template class HeapStress<AvlHeap<uint32_t, 2, true> , 512*1024, 64, 0, 4096, false>;
 template class HeapStress<BestFitHeap<uint32_t, 2, true>, 512*1024, 64, 0, 4096, false>;
 template class HeapStress<TlsfHeap<uint32_t, 2, true>, 256*1024, 64, 0, 4096, false>;
+#ifdef HEAP_EXTENSIONS
+template class HeapStress<SegregatedFitHeap<uint32_t, 2, true>, 256*1024, 64, 0, 4096, false>;
+#endif
 
 template class HeapStress<AvlHeap<uint32_t, 2, true> , 512*1024, 64, 0, 4096, true>;
 template class HeapStress<BestFitHeap<uint32_t, 2, true>, 512*1024, 64, 0, 4096, true>;
 template class HeapStress<TlsfHeap<uint32_t, 2, true>, 256*1024, 64, 0, 4096, true>;
+#ifdef HEAP_EXTENSIONS
+template class HeapStress<SegregatedFitHeap<uint32_t, 2, true>, 256*1024, 64, 0, 4096, true>;
+#endif
@@ -25,6 +25,8 @@
 
 #include "ubiquitous/Trace.h"
 
+#include "TestHeapStats.h"
+
 using namespace pet;
 
 class HeapStressTestTraceTag;
@@ -79,6 +81,15 @@ class HeapStress: pet::Trace<HeapStressTestTraceTag>
         BlockDb db;
         uint32_t state = 1234;
 
+        void checkStats()
+        {
+#ifdef HEAP_EXTENSIONS
+            CHECK(countersMatchWalk(heap.getStats(heap.data), heap.getStats()));
+#else
+            heap.getStats(heap.data);
+#endif
+        }
+
         unsigned int random(unsigned int l, unsigned int h)
         {
             if(h > l)
@@ -98,7 +109,7 @@ class HeapStress: pet::Trace<HeapStressTestTraceTag>
 
                 auto ptr = heap.alloc(blockSize, hot);
 
-                heap.getStats(heap.data);
+                checkStats();
 
                 if(ptr == nullptr)
                 {
@@ -117,7 +128,7 @@ class HeapStress: pet::Trace<HeapStressTestTraceTag>
                 int n = random(0, db.getSize() - 1);
                 amount -= db[n].size;
                 heap.free(db[n].ptr);
-                heap.getStats(heap.data);
+                checkStats();
                 db.remove(n);
             };
         }
@@ -130,10 +141,39 @@ class HeapStress: pet::Trace<HeapStressTestTraceTag>
                 int blockSize = random(minAlloc, db[n].size);
                 unsigned int oldSize = db[n].size;
                 db[n].size = heap.resize(db[n].ptr, blockSize);
-                heap.getStats(heap.data);
+                checkStats();
                 amount -= oldSize - db[n].size;
             };
         }
+
+#ifdef HEAP_EXTENSIONS
+        void random_grow(int amount)
+        {
+            while(amount > 0)
+            {
+                int n = random(0, db.getSize() - 1);
+                unsigned int oldSize = db[n].size;
+                unsigned int blockSize = random(oldSize, 2 * oldSize + 1);
+
+                auto ptr = heap.reallocate(db[n].ptr, blockSize);
+                checkStats();
+
+                if(ptr == nullptr)
+                {
+                    break;
+                }
+
+                for(unsigned int i = 0; i < oldSize; i++)
+                {
+                    CHECK(((unsigned char*)ptr)[i] == 0x5a);
+                }
+
+                memset(ptr, 0x5a, blockSize);
+                db[n] = typename BlockDb::Entry(ptr, blockSize);
+                amount -= blockSize - oldSize;
+            };
+        }
+#endif
     };
 
     BEGIN_TEST_CASE(HeapStress, RandomAllocFree)
@@ -158,6 +198,21 @@ class HeapStress: pet::Trace<HeapStressTestTraceTag>
         }
     }
     END_TEST_CASE()
+
+#ifdef HEAP_EXTENSIONS
+    BEGIN_TEST_CASE(HeapStress, RandomAllocGrowFree)
+    {
+        for(int i=0; i<rounds; i++)
+        {
+            this->random_fill();
+            this->random_free(heapSize/2);
+            this->random_grow(heapSize/10);
+        }
+
+        this->random_free(heapSize);
+    }
+    END_TEST_CASE()
+#endif
 };
 
 #endif /* HEAPSTRESS_H_ */
@@ -0,0 +1,244 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/ThreadCache.h"
+
+#include <mutex>
+#include <thread>
+#include <cstring>
+
+using namespace pet;
+
+TEST_GROUP(ThreadCache)
+{
+    using Heap = ThreadCachingHeap<TlsfHeap<uint32_t, 2, true>, std::mutex, 8>;
+
+    struct Uut: Heap
+    {
+        uint32_t data[64 * 1024 / sizeof(uint32_t)];
+        Uut(): Heap(data, sizeof(data)) {}
+
+        auto stats() {
+            return this->getStats(data);
+        }
+    };
+
+    Uut uut;
+};
+
+TEST(ThreadCache, Sanity)
+{
+    {
+        Uut::Cache cache(uut);
+
+        auto p = cache.alloc(24);
+        CHECK(p);
+
+        cache.free(p);
+    }
+
+    CHECK(uut.stats().nUsed == 0);
+}
+
+TEST(ThreadCache, RefillIsBatched)
+{
+    Uut::Cache cache(uut);
+
+    auto p = cache.alloc(24);
+    CHECK(p);
+
+    CHECK(uut.stats().nUsed == Uut::batchSize);
+
+    for(int i = 1; i < Uut::batchSize; i++)
+        CHECK(cache.alloc(24));
+
+    CHECK(uut.stats().nUsed == Uut::batchSize);
+
+    CHECK(cache.alloc(24));
+
+    CHECK(uut.stats().nUsed == 2 * Uut::batchSize);
+}
+
+TEST(ThreadCache, FreedIsReused)
+{
+    Uut::Cache cache(uut);
+
+    auto p = cache.alloc(24);
+    cache.free(p);
+
+    auto q = cache.alloc(24);
+    CHECK(p == q);
+
+    cache.free(q);
+    cache.flush();
+
+    CHECK(uut.stats().nUsed == 0);
+}
+
+TEST(ThreadCache, SizeClassesAreSeparate)
+{
+    Uut::Cache cache(uut);
+
+    auto p = cache.alloc(8);
+    cache.free(p);
+
+    auto q = cache.alloc(Uut::maxCachedSize);
+    CHECK(p != q);
+
+    cache.free(q);
+    cache.flush();
+
+    CHECK(uut.stats().nUsed == 0);
+}
+
+TEST(ThreadCache, LargeBypassesCache)
+{
+    Uut::Cache cache(uut);
+
+    auto p = cache.alloc(Uut::maxCachedSize + 1);
+    CHECK(p);
+
+    CHECK(uut.stats().nUsed == 1);
+
+    cache.free(p);
+
+    CHECK(uut.stats().nUsed == 0);
+}
+
+TEST(ThreadCache, OverfullMagazineFlushed)
+{
+    void* ptrs[4 * Uut::batchSize];
+
+    Uut::Cache cache(uut);
+
+    for(auto &p: ptrs)
+        CHECK(p = cache.alloc(24));
+
+    CHECK(uut.stats().nUsed == sizeof(ptrs) / sizeof(ptrs[0]));
+
+    for(auto &p: ptrs)
+        cache.free(p);
+
+    CHECK(uut.stats().nUsed <= Uut::magazineSize);
+
+    cache.flush();
+
+    CHECK(uut.stats().nUsed == 0);
+}
+
+TEST(ThreadCache, DestructorFlushes)
+{
+    {
+        Uut::Cache cache(uut);
+
+        for(int i = 0; i < 3 * Uut::batchSize; i++)
+            cache.free(cache.alloc(i % Uut::maxCachedSize));
+    }
+
+    CHECK(uut.stats().nUsed == 0);
+}
+
+TEST(ThreadCache, FreeOnOtherThread)
+{
+    void* ptrs[16];
+
+    {
+        Uut::Cache cache(uut);
+
+        for(auto &p: ptrs)
+            CHECK(p = cache.alloc(24));
+    }
+
+    std::thread([this, &ptrs](){
+        Uut::Cache cache(uut);
+
+        for(auto &p: ptrs)
+            cache.free(p);
+    }).join();
+
+    CHECK(uut.stats().nUsed == 0);
+}
+
+/*
+ * Every thread keeps a few blocks filled with its own pattern and checks them
+ * before release, so handing out the same block to two threads is detected.
+ */
+TEST(ThreadCache, Concurrent)
+{
+    static constexpr auto nThreads = 8;
+    std::thread threads[nThreads];
+    bool results[nThreads];
+
+    for(int i = 0; i < nThreads; i++)
+    {
+        threads[i] = std::thread([this, &results, i]()
+        {
+            Uut::Cache cache(uut);
+            uint8_t* ptrs[8] = {nullptr, };
+            bool ok = true;
+
+            for(int n = 0; n < 10000; n++)
+            {
+                auto &p = ptrs[n % 8];
+
+                if(p)
+                {
+                    for(int j = 0; j < 24; j++)
+                        ok = ok && p[j] == i;
+
+                    cache.free(p);
+                }
+
+                if((p = (uint8_t*)cache.alloc(24)))
+                    memset(p, i, 24);
+            }
+
+            for(auto p: ptrs)
+            {
+                if(p)
+                    cache.free(p);
+            }
+
+            results[i] = ok;
+        });
+    }
+
+    for(auto &t: threads)
+        t.join();
+
+    for(auto r: results)
+        CHECK(r);
+
+    CHECK(uut.stats().nUsed == 0);
+}
+
+TEST(ThreadCache, Exhaustion)
+{
+    Uut::Cache cache(uut);
+
+    while(cache.alloc(Uut::maxCachedSize));
+
+    auto s = uut.stats();
+    CHECK(s.longestFree < Uut::maxCachedSize);
+
+    CHECK(!cache.alloc(sizeof(Uut::data) / 2));
+}
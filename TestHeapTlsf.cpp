@@ -22,6 +22,10 @@
 #include "heap/Heap.h"
 #include "heap/TlsfPolicy.h"
 
+#include "TestHeapStats.h"
+
+#include <cstring>
+
 using namespace pet;
 
 using Policy = TlsfPolicy<uint32_t> ;
@@ -392,3 +396,145 @@ TEST(TestTlsfHeap, ShrinkTest3)
     auto s = uut.heap.getStats(uut.data);
     CHECK(s.nUsed == 0 && s.totalUsed == 0);
 }
+
+#ifdef HEAP_EXTENSIONS
+
+TEST(TestTlsfHeap, GrowTest1)
+{
+    void *d[3];
+    d[0] = uut.alloc(0x1000 - Uut::usedBlockHeaderSize);
+    d[1] = uut.alloc(0x1000 - Uut::usedBlockHeaderSize);
+    d[2] = uut.alloc(0x1000 - Uut::usedBlockHeaderSize);
+
+    uut.heap.free(d[1]);
+
+    CHECK(d[0] == uut.heap.reallocate(d[0], 0x1800 - Uut::usedBlockHeaderSize));
+    CHECK(d[0] == uut.heap.reallocate(d[0], 0x2000 - Uut::usedBlockHeaderSize));
+
+    uut.heap.free(d[0]);
+    uut.heap.free(d[2]);
+
+    auto s = uut.heap.getStats(uut.data);
+    CHECK(s.nUsed == 0 && s.totalUsed == 0);
+}
+
+TEST(TestTlsfHeap, GrowTest2)
+{
+    void *d[3];
+    d[0] = uut.alloc(0x1000 - Uut::usedBlockHeaderSize);
+    d[1] = uut.alloc(0x1000 - Uut::usedBlockHeaderSize);
+
+    memset(d[0], 0x5a, 0x1000 - Uut::usedBlockHeaderSize);
+
+    d[2] = uut.heap.reallocate(d[0], 0x2000);
+    CHECK(d[2] && d[2] != d[0]);
+
+    for(int i = 0; i < 0x1000 - Uut::usedBlockHeaderSize; i++)
+        CHECK(((char*)d[2])[i] == 0x5a);
+
+    d[0] = uut.alloc(0x1000 - Uut::usedBlockHeaderSize);
+
+    uut.heap.free(d[0]);
+    uut.heap.free(d[1]);
+    uut.heap.free(d[2]);
+
+    auto s = uut.heap.getStats(uut.data);
+    CHECK(s.nUsed == 0 && s.totalUsed == 0);
+}
+
+TEST(TestTlsfHeap, GrowTest3)
+{
+    void *d = uut.alloc(0x1000 - Uut::usedBlockHeaderSize);
+
+    CHECK(uut.heap.reallocate(d, sizeof(Uut::data)) == nullptr);
+    CHECK(d == uut.heap.reallocate(d, sizeof(Uut::data) / 2));
+
+    uut.heap.free(d);
+
+    auto s = uut.heap.getStats(uut.data);
+    CHECK(s.nUsed == 0 && s.totalUsed == 0);
+}
+
+TEST(TestTlsfHeap, AlignedTest)
+{
+    void *d[4];
+    d[0] = uut.alloc(1);
+    d[1] = uut.heap.allocAligned(100, 64);
+    d[2] = uut.heap.allocAligned(0x1000, 4096);
+    CHECK(d[1] && !((uintptr_t)d[1] & 63));
+    CHECK(d[2] && !((uintptr_t)d[2] & 4095));
+
+    d[3] = uut.alloc(16);
+
+    // The leading slack is only reused if there is enough of it, which depends on where the arena is.
+    auto slack = [](void* end, void* next) {
+        return (uintptr_t)next - Uut::usedBlockHeaderSize - (uintptr_t)end;
+    };
+
+    const auto needed = 16 + Uut::usedBlockHeaderSize;
+
+    if(slack((char*)d[0] + 4, d[1]) >= needed || slack((char*)d[1] + 100, d[2]) >= needed)
+        CHECK(d[3] < d[2]);
+
+    uut.heap.free(d[0]);
+    uut.heap.free(d[1]);
+    uut.heap.free(d[2]);
+    uut.heap.free(d[3]);
+
+    auto s = uut.heap.getStats(uut.data);
+    CHECK(s.nUsed == 0 && s.totalUsed == 0);
+    CHECK(s.longestFree == s.totalFree);
+}
+
+TEST(TestTlsfHeap, BatchTest)
+{
+    void *d[64];
+
+    CHECK(uut.heap.allocBatch(64, 0x40, d) == 64);
+
+    uut.heap.freeBatch(d + 32, 32);
+
+    CHECK(uut.heap.allocBatch(16, 0x80, d + 32) == 16);
+
+    uut.heap.freeBatch(d, 48);
+
+    auto s = uut.heap.getStats(uut.data);
+    CHECK(s.nUsed == 0 && s.totalUsed == 0);
+    CHECK(s.longestFree == s.totalFree);
+}
+
+TEST(TestTlsfHeap, StatsCounters)
+{
+    auto check = [this]() {
+        CHECK(countersMatchWalk(uut.heap.getStats(uut.data), uut.heap.getStats()));
+    };
+
+    void *d[4];
+    check();
+
+    d[0] = uut.alloc(0x1000 - Uut::usedBlockHeaderSize);
+    d[1] = uut.alloc(0x0100 - Uut::usedBlockHeaderSize);
+    d[2] = uut.alloc(0x1000 - Uut::usedBlockHeaderSize);
+    d[3] = uut.alloc(0x0010 - Uut::usedBlockHeaderSize);
+    check();
+
+    uut.heap.free(d[0]);
+    uut.heap.free(d[2]);
+    check();
+
+    d[0] = uut.heap.dropFront(d[1], 0x40);
+    check();
+
+    uut.heap.resize(d[0], 1);
+    check();
+
+    uut.heap.free(d[0]);
+    uut.heap.free(d[3]);
+    check();
+
+    auto s = uut.heap.getStats();
+    CHECK(s.nUsed == 0 && s.totalUsed == 0);
+    CHECK(s.longestFree == s.totalFree);
+}
+
+#endif
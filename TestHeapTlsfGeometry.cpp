@@ -0,0 +1,183 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/Heap.h"
+#include "heap/TlsfPolicy.h"
+
+#include <sys/mman.h>
+
+using namespace pet;
+
+/*
+ * Reference mapping: sizes below the second level count map linearly onto
+ * the first row, above that the first level is given by the position of the
+ * most significant bit and the second level by the next log2(slCount) bits.
+ */
+template<class SizeType, unsigned int slCount>
+struct TlsfReference
+{
+    static constexpr unsigned int slBits = __builtin_ctz(slCount);
+
+    static unsigned int msb(SizeType s) {
+        return 63 - __builtin_clzll(s);
+    }
+
+    static unsigned int fl(SizeType s) {
+        return (s < slCount) ? 0 : msb(s) - slBits + 1;
+    }
+
+    static unsigned int sl(SizeType s) {
+        return (s < slCount) ? (unsigned int)s : (unsigned int)(s >> (fl(s) - 1)) & (slCount - 1);
+    }
+};
+
+template<class SizeType, unsigned int slCount, unsigned int flCount>
+struct TlsfGeometryTest
+{
+    using Policy = TlsfPolicy<SizeType, slCount, flCount>;
+    using Index = typename Policy::Index;
+    using Reference = TlsfReference<SizeType, slCount>;
+
+    static_assert(Index::slCount == slCount);
+    static_assert(Index::flCount == flCount);
+
+    TEST_GROUP(TlsfGeometry) {};
+
+    BEGIN_TEST_CASE(TlsfGeometry, IndexMapping)
+    {
+        for(SizeType s = 0; s < 4096; s++)
+        {
+            auto e = Index::getInsertionEntry(s);
+            CHECK(e.fl == Reference::fl(s) && e.sl == Reference::sl(s));
+        }
+
+        for(SizeType s = 4096; s && Reference::fl(s) < flCount; s += s / 7 + 1)
+        {
+            auto e = Index::getInsertionEntry(s);
+            CHECK(e.fl == Reference::fl(s) && e.sl == Reference::sl(s));
+        }
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(TlsfGeometry, IndexLookup)
+    {
+        Index index;
+
+        SizeType sizes[] = {1, slCount + 1, SizeType(slCount) << 8, SizeType(slCount) << (flCount - 2)};
+
+        for(auto s: sizes)
+            index.setBits(Index::getInsertionEntry(s));
+
+        for(auto s: sizes)
+        {
+            auto e = Index::getInsertionEntry(s);
+            auto q = index.getGreaterEqualEntry(s - 1);
+            CHECK(q.fl == e.fl && q.sl == e.sl);
+        }
+
+        auto top = Index::getInsertionEntry(sizes[3]);
+        auto q = index.getGreaterEqualEntry(sizes[2] + 1);
+        CHECK(q.fl == top.fl && q.sl == top.sl);
+    }
+    END_TEST_CASE()
+
+    BEGIN_TEST_CASE(TlsfGeometry, HeapRoundTrip)
+    {
+        static uint64_t data[64 * 1024 / sizeof(uint64_t)];
+        Heap<Policy, SizeType, 3> heap(data, sizeof(data));
+
+        void* ptrs[64];
+        uint32_t state = 1234;
+
+        for(int round = 0; round < 16; round++)
+        {
+            for(auto &p: ptrs)
+            {
+                state = state * 1103515245 + 12345;
+                p = heap.alloc((state >> 16) % 1000);
+            }
+
+            for(auto p: ptrs)
+                if(p)
+                    heap.free(p);
+        }
+
+        auto s = heap.getStats(data);
+        CHECK(s.nUsed == 0 && s.longestFree == s.totalFree);
+    }
+    END_TEST_CASE()
+};
+
+template struct TlsfGeometryTest<uint32_t, 4, 28>;
+template struct TlsfGeometryTest<uint32_t, 8, 27>;
+template struct TlsfGeometryTest<uint32_t, 16, 26>;
+template struct TlsfGeometryTest<uint32_t, 32, 25>;
+template struct TlsfGeometryTest<uint32_t, 64, 24>;
+
+template struct TlsfGeometryTest<uint32_t, 16, 16>;
+
+template struct TlsfGeometryTest<uint64_t, 4, 60>;
+template struct TlsfGeometryTest<uint64_t, 16, 58>;
+template struct TlsfGeometryTest<uint64_t, 64, 56>;
+
+TEST_GROUP(TlsfHugeHeap)
+{
+    using TestHeap = Heap<TlsfPolicy<uint64_t, 32>, uint64_t, 4>;
+
+    static constexpr uint64_t gigabyte = uint64_t(1) << 30;
+    static constexpr uint64_t arenaSize = 8 * gigabyte;
+
+    void* arena;
+
+    TEST_SETUP() {
+        arena = mmap(nullptr, arenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    }
+
+    TEST_TEARDOWN() {
+        if(arena != MAP_FAILED)
+            munmap(arena, arenaSize);
+    }
+};
+
+TEST(TlsfHugeHeap, BeyondFourGigabytes)
+{
+    if(arena == MAP_FAILED)
+        return;
+
+    TestHeap heap(arena, arenaSize);
+
+    auto s = heap.getStats(arena);
+    CHECK(s.longestFree > 7 * gigabyte);
+
+    auto small = heap.alloc(100);
+    auto big = (char*)heap.alloc(5 * gigabyte);
+    CHECK(small && big);
+
+    big[0] = 1;
+    big[5 * gigabyte - 1] = 2;
+
+    CHECK(!heap.alloc(4 * gigabyte));
+
+    heap.free(big);
+    CHECK(heap.alloc(6 * gigabyte));
+
+    heap.free(small);
+}
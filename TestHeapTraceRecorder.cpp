@@ -0,0 +1,146 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/HeapTrace.h"
+
+#include <vector>
+#include <cstdio>
+
+#include <unistd.h>
+
+using namespace pet;
+
+TEST_GROUP(HeapTraceRecorder)
+{
+    struct MemorySink
+    {
+        static inline std::vector<HeapTraceRecord> records;
+
+        static inline void write(const HeapTraceRecord& r) {
+            records.push_back(r);
+        }
+    };
+
+    using Uut = RecordingHeap<TlsfHeap<uint32_t, 2, true>, MemorySink>;
+
+    struct Heap: Uut
+    {
+        uint32_t data[16 * 1024 / sizeof(uint32_t)];
+        Heap(): Uut(data, sizeof(data)) {}
+    };
+
+    Heap heap;
+
+    TEST_SETUP() {
+        MemorySink::records.clear();
+    }
+
+    bool check(unsigned int idx, HeapTraceRecord::Op op, void* ptr, uint32_t size)
+    {
+        if(idx >= MemorySink::records.size())
+            return false;
+
+        const auto &r = MemorySink::records[idx];
+        return r.op == op && r.ptr == (uintptr_t)ptr && r.size == size;
+    }
+};
+
+TEST(HeapTraceRecorder, RecordSize)
+{
+    CHECK(sizeof(HeapTraceRecord) <= 24);
+}
+
+TEST(HeapTraceRecorder, Sequence)
+{
+    auto p = heap.alloc(100);
+    auto q = heap.alloc(200, true);
+    heap.resize(p, 50);
+    heap.free(q);
+    heap.free(p);
+
+    CHECK(MemorySink::records.size() == 5);
+    CHECK(check(0, HeapTraceRecord::Op::Alloc, p, 100));
+    CHECK(check(1, HeapTraceRecord::Op::AllocHot, q, 200));
+    CHECK(check(2, HeapTraceRecord::Op::Resize, p, 50));
+    CHECK(check(3, HeapTraceRecord::Op::Free, q, 0));
+    CHECK(check(4, HeapTraceRecord::Op::Free, p, 0));
+
+    for(int i = 1; i < MemorySink::records.size(); i++)
+        CHECK(MemorySink::records[i - 1].timestamp <= MemorySink::records[i].timestamp);
+}
+
+TEST(HeapTraceRecorder, FailureRecorded)
+{
+    CHECK(!heap.alloc(sizeof(Heap::data)));
+
+    CHECK(MemorySink::records.size() == 1);
+    CHECK(check(0, HeapTraceRecord::Op::Alloc, nullptr, sizeof(Heap::data)));
+}
+
+TEST(HeapTraceRecorder, BehavesLikeHeap)
+{
+    void* ptrs[16];
+
+    for(auto &p: ptrs)
+        CHECK(p = heap.alloc(100));
+
+    for(auto p: ptrs)
+        heap.free(p);
+
+    auto s = heap.getStats(heap.data);
+    CHECK(s.nUsed == 0 && s.longestFree == s.totalFree);
+    CHECK(MemorySink::records.size() == 32);
+}
+
+TEST(HeapTraceRecorder, FileRoundTrip)
+{
+    struct Tag;
+    using File = HeapTraceFile<Tag>;
+    using FileHeap = RecordingHeap<TlsfHeap<uint32_t, 2, true>, File>;
+
+    char path[] = "/tmp/pet-heap-trace-XXXXXX";
+    close(mkstemp(path));
+
+    CHECK(File::open(path));
+
+    {
+        static uint32_t data[4 * 1024 / sizeof(uint32_t)];
+        FileHeap h(data, sizeof(data));
+        h.free(h.alloc(10));
+        h.free(h.alloc(20));
+    }
+
+    File::close();
+
+    auto f = fopen(path, "rb");
+    CHECK(f);
+
+    HeapTraceRecord r[5];
+    CHECK(fread(r, sizeof(r[0]), 5, f) == 4);
+    CHECK(r[0].op == HeapTraceRecord::Op::Alloc && r[0].size == 10);
+    CHECK(r[1].op == HeapTraceRecord::Op::Free && r[1].ptr == r[0].ptr);
+    CHECK(r[2].op == HeapTraceRecord::Op::Alloc && r[2].size == 20);
+    CHECK(r[3].op == HeapTraceRecord::Op::Free && r[3].ptr == r[2].ptr);
+
+    fclose(f);
+    remove(path);
+}
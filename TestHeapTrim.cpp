@@ -0,0 +1,181 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/Trim.h"
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <new>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace pet;
+
+using TestHeap = TlsfHeap<uint32_t, 2, true>;
+
+TEST_GROUP(HeapTrim)
+{
+    static constexpr unsigned int arenaSize = 1024 * 1024;
+
+    const unsigned int pageSize = (unsigned int)sysconf(_SC_PAGESIZE);
+    void* const arena = mmap(nullptr, arenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    TestHeap* heap;
+
+    TEST_SETUP()
+    {
+        CHECK(arena != MAP_FAILED);
+        heap = new(arena) TestHeap((char*)arena + pageSize, arenaSize - pageSize);
+    }
+
+    TEST_TEARDOWN() {
+        munmap(arena, arenaSize);
+    }
+
+    unsigned int resident(void* start, unsigned int size)
+    {
+        const auto first = (uintptr_t)start & ~(uintptr_t)(pageSize - 1);
+        const auto last = ((uintptr_t)start + size + pageSize - 1) & ~(uintptr_t)(pageSize - 1);
+        const auto nPages = (last - first) / pageSize;
+
+        unsigned char vec[arenaSize / 4096];
+        CHECK(nPages <= sizeof(vec));
+        CHECK(mincore((void*)first, last - first, vec) == 0);
+
+        unsigned int ret = 0;
+
+        for(unsigned int i = 0; i < nPages; i++)
+        {
+            if(vec[i] & 1)
+                ret++;
+        }
+
+        return ret * pageSize;
+    }
+};
+
+TEST(HeapTrim, ReleasesFreedPages)
+{
+    auto a = heap->alloc(100);
+    auto b = heap->alloc(256 * 1024);
+    auto c = heap->alloc(100);
+    CHECK(a && b && c);
+
+    memset(b, 0x5a, 256 * 1024);
+    CHECK(resident(b, 256 * 1024) >= 256 * 1024);
+
+    heap->free(b);
+
+    const auto released = heap->trim();
+    CHECK(released >= 256 * 1024 - 2 * pageSize);
+    CHECK(released % pageSize == 0);
+    CHECK(resident(b, 256 * 1024) <= 2 * pageSize);
+
+    auto s = heap->getStats((char*)arena + pageSize);
+    CHECK(s.nUsed == 2);
+    CHECK(s.totalFree == heap->getStats().totalFree);
+
+    heap->free(a);
+    heap->free(c);
+
+    CHECK(heap->getStats().nUsed == 0);
+}
+
+TEST(HeapTrim, TrimmedBlocksStayUsable)
+{
+    auto a = heap->alloc(100);
+    auto b = heap->alloc(128 * 1024);
+    auto c = heap->alloc(100);
+    CHECK(a && b && c);
+
+    memset(a, 0x11, 100);
+    memset(c, 0x33, 100);
+
+    heap->free(b);
+    CHECK(heap->trim() > 0);
+
+    for(int i = 0; i < 100; i++)
+        CHECK(((uint8_t*)a)[i] == 0x11 && ((uint8_t*)c)[i] == 0x33);
+
+    b = heap->alloc(128 * 1024);
+    CHECK(b);
+    memset(b, 0x22, 128 * 1024);
+
+    heap->free(a);
+    heap->free(b);
+    heap->free(c);
+
+    auto s = heap->getStats();
+    CHECK(s.nUsed == 0 && s.longestFree == s.totalFree);
+}
+
+TEST(HeapTrim, SmallFreeBlocksAreKept)
+{
+    void* ptrs[256];
+
+    for(auto &p: ptrs)
+    {
+        CHECK(p = heap->alloc(pageSize / 2));
+        memset(p, 0x5a, pageSize / 2);
+    }
+
+    for(unsigned int i = 0; i < sizeof(ptrs) / sizeof(ptrs[0]); i += 2)
+        heap->free(ptrs[i]);
+
+    const auto tail = heap->getStats().longestFree;
+    CHECK(heap->trim() <= tail);
+
+    for(unsigned int i = 1; i < sizeof(ptrs) / sizeof(ptrs[0]); i += 2)
+    {
+        for(unsigned int j = 0; j < pageSize / 2; j++)
+            CHECK(((uint8_t*)ptrs[i])[j] == 0x5a);
+
+        heap->free(ptrs[i]);
+    }
+
+    CHECK(heap->getStats().nUsed == 0);
+}
+
+TEST(HeapTrim, Background)
+{
+    std::mutex lock;
+    auto p = heap->alloc(256 * 1024);
+    CHECK(p);
+    memset(p, 0x5a, 256 * 1024);
+
+    BackgroundTrimmer<TestHeap, std::mutex> trimmer(*heap, lock, std::chrono::milliseconds(1));
+
+    {
+        std::lock_guard<std::mutex> _(lock);
+        heap->free(p);
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+    while(trimmer.getReleased() < 256 * 1024 - 2 * pageSize && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    CHECK(trimmer.getReleased() >= 256 * 1024 - 2 * pageSize);
+    CHECK(resident(p, 256 * 1024) <= 2 * pageSize);
+}
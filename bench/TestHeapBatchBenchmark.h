@@ -0,0 +1,132 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#ifndef HEAPBATCHBENCHMARK_H_
+#define HEAPBATCHBENCHMARK_H_
+
+#include <chrono>
+
+#include "ubiquitous/Trace.h"
+
+using namespace pet;
+
+class HeapBenchmarkTraceTag;
+
+template <class Heap, unsigned int heapSize, unsigned int rounds, unsigned int nBlocks, unsigned int minAlloc, unsigned int maxAlloc>
+class HeapBatchBenchmark: pet::Trace<HeapBenchmarkTraceTag>
+{
+    TEST_GROUP(HeapBatchBenchmark)
+    {
+        struct Uut: Heap
+        {
+            uint32_t data[heapSize / sizeof(uint32_t)];
+            Uut(): Heap(data, sizeof(data)) {}
+        };
+
+        Uut heap;
+        void* ptrs[nBlocks];
+        uint32_t state = 1234;
+
+        unsigned int random(unsigned int l, unsigned int h)
+        {
+            state = state * 1103515245 + 12345;
+            return l + ((state >> 16) % (h - l + 1));
+        }
+
+        /*
+         * Allocates a connection worth of mixed size blocks, interleaved
+         * with some long lived ones so that the heap gets fragmented.
+         */
+        unsigned int fill(void** keep, unsigned int &nKept)
+        {
+            unsigned int n = 0;
+
+            while(n < nBlocks)
+            {
+                auto ptr = heap.alloc(random(minAlloc, maxAlloc));
+
+                if(!ptr)
+                {
+                    break;
+                }
+
+                if(random(0, 63) == 0)
+                {
+                    keep[nKept++] = ptr;
+                }
+                else
+                {
+                    ptrs[n++] = ptr;
+                }
+            }
+
+            return n;
+        }
+
+        template<class Release>
+        unsigned long measure(Release&& release)
+        {
+            static void* keep[rounds * nBlocks];
+            unsigned int nKept = 0;
+            unsigned long ns = 0, ops = 0;
+
+            for(unsigned int i = 0; i < rounds; i++)
+            {
+                const auto n = fill(keep, nKept);
+
+                const auto start = std::chrono::steady_clock::now();
+                release(n);
+                const auto end = std::chrono::steady_clock::now();
+
+                ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+                ops += n;
+            }
+
+            heap.freeBatch(keep, nKept);
+
+            auto s = heap.getStats(heap.data);
+            CHECK(s.nUsed == 0 && s.totalUsed == 0);
+
+            return ops ? ns / ops : 0;
+        }
+    };
+
+    BEGIN_TEST_CASE(HeapBatchBenchmark, Release)
+    {
+        const auto single = this->measure([this](unsigned int n)
+        {
+            for(unsigned int i = 0; i < n; i++)
+            {
+                this->heap.free(this->ptrs[i]);
+            }
+        });
+
+        this->state = 1234;
+
+        const auto batched = this->measure([this](unsigned int n)
+        {
+            this->heap.freeBatch(this->ptrs, n);
+        });
+
+        HeapBatchBenchmark::info() << "free: " << single << " ns/block, freeBatch: " << batched << " ns/block\n";
+    }
+    END_TEST_CASE()
+};
+
+#endif /* HEAPBATCHBENCHMARK_H_ */
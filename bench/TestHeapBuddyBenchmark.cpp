@@ -0,0 +1,101 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "heap/Buddy.h"
+#include "heap/BitmapBuddy.h"
+
+#include "ubiquitous/Trace.h"
+
+#include "1test/Test.h"
+
+#include <chrono>
+#include <memory>
+
+class HeapBenchmarkTraceTag;
+
+TEST_GROUP(BuddyBenchmark)
+{
+    struct Report: pet::Trace<HeapBenchmarkTraceTag> {};
+
+    static constexpr auto unitBits = 4u;
+    static constexpr auto nUnits = 1024u * 1024u;
+    static constexpr auto nPtrs = 64u * 1024u;
+
+    /*
+     * Same Fibonacci-ish size sequence as the randomized stress test in the
+     * suite, in allocation units, run on an arena of a million units.
+     */
+    template<class Allocator>
+    unsigned long run(char* data, size_t dataSize)
+    {
+        Allocator uut;
+
+        auto minTree = Allocator::minimalTreeSize(dataSize);
+        CHECK(minTree > 0);
+
+        std::unique_ptr<char[]> tree(new char[minTree]);
+        CHECK(uut.init(data, data + dataSize, tree.get(), minTree));
+
+        std::unique_ptr<void*[]> ptrs(new void*[nPtrs]);
+        unsigned int idx = 0, a = 1, b = 1;
+        unsigned long ops = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for(int round = 0; round < 100; round++)
+        {
+            while(idx < nPtrs)
+            {
+                auto size = (a + b) % 31;
+                b = a;
+                a = size;
+
+                ops++;
+
+                if(auto x = uut.allocate(size << unitBits))
+                    ptrs[idx++] = x;
+                else
+                    break;
+            }
+
+            for(auto nFree = idx / 2; nFree; nFree--, ops++)
+                uut.free(ptrs[--idx]);
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+
+        while(idx)
+            uut.free(ptrs[--idx]);
+
+        CHECK(uut.allocate(dataSize));
+
+        return (unsigned long)(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / ops);
+    }
+};
+
+TEST(BuddyBenchmark, RandomStressHugeArena)
+{
+    const size_t dataSize = size_t(nUnits) << unitBits;
+    std::unique_ptr<char[]> data(new char[dataSize]);
+
+    const auto tree = run<pet::BuddyAllocator<unitBits, 2>>(data.get(), dataSize);
+    const auto bitmap = run<pet::BitmapBuddyAllocator<unitBits, 2>>(data.get(), dataSize);
+
+    Report::info() << "tree: " << tree << " ns/op, bitmap: " << bitmap << " ns/op\n";
+}
@@ -0,0 +1,112 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "heap/ConcurrentBuddy.h"
+
+#include "ubiquitous/Trace.h"
+
+#include "1test/Test.h"
+
+#include <chrono>
+#include <thread>
+
+class HeapBenchmarkTraceTag;
+
+TEST_GROUP(ConcurrentBuddyBenchmark)
+{
+    struct Report: pet::Trace<HeapBenchmarkTraceTag> {};
+
+    static constexpr auto unitBits = 4u;
+    static constexpr auto nUnits = 16u * 1024u;
+    static constexpr auto maxThreads = 16u;
+    static constexpr auto rounds = 10000u;
+
+    using Allocator = pet::ConcurrentBuddyAllocator<unitBits, 2>;
+
+    alignas(1 << unitBits) char data[nUnits << unitBits];
+    char tree[16 * 1024];
+
+    Allocator uut;
+
+    TEST_SETUP()
+    {
+        auto minTree = Allocator::minimalTreeSize(sizeof(data));
+        CHECK(0 < minTree && minTree <= sizeof(tree));
+        CHECK(uut.init(data, data + sizeof(data), tree, minTree));
+    }
+
+    /*
+     * Same size sequence as the randomized stress run, without the overlap
+     * tracking of the correctness test so that only the allocator is timed.
+     */
+    void run(unsigned int seed)
+    {
+        void* ptrs[256];
+        unsigned int idx = 0, a = seed, b = 1;
+
+        for(unsigned int round = 0; round < rounds; round++)
+        {
+            while(idx < sizeof(ptrs) / sizeof(ptrs[0]))
+            {
+                auto size = (a + b) % 31;
+                b = a;
+                a = size;
+
+                if(auto x = uut.allocate(size << unitBits))
+                    ptrs[idx++] = x;
+                else
+                    break;
+            }
+
+            for(auto nFree = idx / 2; nFree; nFree--)
+                uut.free(ptrs[--idx]);
+        }
+
+        while(idx)
+            uut.free(ptrs[--idx]);
+    }
+
+    unsigned long roundsPerSec(unsigned int nThreads)
+    {
+        std::thread threads[maxThreads];
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for(unsigned int i = 0; i < nThreads; i++)
+            threads[i] = std::thread([this, i](){ run(i + 1); });
+
+        for(unsigned int i = 0; i < nThreads; i++)
+            threads[i].join();
+
+        const auto end = std::chrono::steady_clock::now();
+
+        auto all = uut.allocate(sizeof(data));
+        CHECK(all);
+        uut.free(all);
+
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        return (unsigned long)((unsigned long long)nThreads * rounds * 1000000 / (us ? us : 1));
+    }
+};
+
+TEST(ConcurrentBuddyBenchmark, Scaling)
+{
+    for(unsigned int n = 1; n <= maxThreads; n <<= 1)
+        Report::info() << n << " threads: " << roundsPerSec(n) << " rounds/s\n";
+}
@@ -0,0 +1,106 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/LockFreePool.h"
+#include "heap/TlsfPolicy.h"
+
+#include "ubiquitous/Trace.h"
+
+#include "TestHeapThreadedStress.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace pet;
+
+template<class Allocator, unsigned int nThreads, unsigned int rounds>
+static unsigned long measureNsPerOp()
+{
+    std::thread threads[nThreads];
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for(auto &t: threads)
+    {
+        t = std::thread([]()
+        {
+            void* ptrs[8];
+
+            for(int n = 0; n < rounds; n++)
+            {
+                for(auto &p: ptrs)
+                    p = Allocator::alloc(32);
+
+                for(auto p: ptrs)
+                    Allocator::free(p);
+            }
+        });
+    }
+
+    for(auto &t: threads)
+        t.join();
+
+    const auto end = std::chrono::steady_clock::now();
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return (unsigned long)(ns / (2ull * 8 * rounds));
+}
+
+TEST_GROUP(LockFreePoolBenchmark)
+{
+    struct Report: pet::Trace<HeapBenchmarkTraceTag> {};
+
+    struct Tag;
+    using Pool = pet::LockFreePool<32, 1024, Tag>;
+
+    struct Backing: LockedHeap<TlsfHeap<uint32_t, 2, true>>
+    {
+        uint32_t data[256 * 1024 / sizeof(uint32_t)];
+        Backing(): LockedHeap(data, sizeof(data)) {}
+    };
+
+    static inline Backing backing;
+
+    struct Locked
+    {
+        static inline void* alloc(unsigned int s) { return Backing::Cache(backing).alloc(s); }
+        static inline void free(void* p) { Backing::Cache(backing).free(p); }
+    };
+
+    template<unsigned int nThreads>
+    void compare()
+    {
+        const auto pool = measureNsPerOp<Pool, nThreads, 100000>();
+        const auto heap = measureNsPerOp<Locked, nThreads, 100000>();
+        Report::info() << nThreads << " threads: pool " << pool << " ns/op, locked heap " << heap << " ns/op\n";
+    }
+};
+
+TEST(LockFreePoolBenchmark, Latency)
+{
+    compare<1>();
+    compare<2>();
+    compare<4>();
+    compare<8>();
+    compare<16>();
+
+    CHECK(Pool::allFreed());
+    CHECK(backing.getStats(backing.data).nUsed == 0);
+}
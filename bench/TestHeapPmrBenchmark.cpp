@@ -0,0 +1,80 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/MemoryResource.h"
+
+#include "ubiquitous/Trace.h"
+
+#include <chrono>
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+using namespace pet;
+
+class HeapBenchmarkTraceTag;
+
+TEST_GROUP(MemoryResourceBenchmark)
+{
+    struct Report: pet::Trace<HeapBenchmarkTraceTag> {};
+
+    using TestHeap = TlsfHeap<uint32_t, 3, false>;
+
+    struct Heap: TestHeap
+    {
+        uint64_t data[4 * 1024 * 1024 / sizeof(uint64_t)];
+        Heap(): TestHeap(data, sizeof(data)) {}
+    };
+
+    static unsigned long churn(std::pmr::memory_resource* resource)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        for(int round = 0; round < 100; round++)
+        {
+            std::pmr::unordered_map<int, std::pmr::vector<int>> m(resource);
+
+            for(int i = 0; i < 1000; i++)
+                m[i].resize(i % 17 + 1, i);
+
+            for(int i = 0; i < 1000; i += 2)
+                m.erase(i);
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+        return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    }
+};
+
+TEST(MemoryResourceBenchmark, ContainerChurn)
+{
+    std::unique_ptr<Heap> heap(new Heap);
+    pet::HeapMemoryResource<TestHeap> resource(*heap);
+
+    const auto tlsf = churn(&resource);
+    const auto newDelete = churn(std::pmr::new_delete_resource());
+
+    Report::info() << "tlsf: " << tlsf << " us, new/delete: " << newDelete << " us\n";
+
+    CHECK(heap->getStats(heap->data).nUsed == 0);
+}
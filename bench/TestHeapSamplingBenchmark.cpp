@@ -0,0 +1,93 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/Sampling.h"
+
+#include "ubiquitous/Trace.h"
+
+#include <chrono>
+
+using namespace pet;
+
+class HeapBenchmarkTraceTag;
+
+TEST_GROUP(AllocationSamplingBenchmark)
+{
+    struct Report: pet::Trace<HeapBenchmarkTraceTag> {};
+
+    using Profiler = AllocationProfiler<256, 32>;
+    using TestHeap = SamplingHeap<TlsfHeap<uint32_t, 2, true>, Profiler>;
+
+    struct Uut: TestHeap
+    {
+        uint32_t data[64 * 1024 / sizeof(uint32_t)];
+        Uut(): TestHeap(data, sizeof(data)) {}
+    };
+
+    Profiler profiler;
+    Uut uut;
+
+    TEST_SETUP() {
+        profiler.setSeed(1234);
+    }
+
+    /*
+     * Allocates and immediately frees the given number of blocks of the given size.
+     */
+    unsigned long churn(unsigned int n, unsigned int size)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        for(unsigned int i = 0; i < n; i++)
+        {
+            auto p = uut.alloc(size);
+            CHECK(p);
+            uut.free(p);
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+        return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    }
+};
+
+TEST(AllocationSamplingBenchmark, Overhead)
+{
+    static constexpr unsigned int n = 1000000;
+
+    uut.setProfiler(nullptr);
+    const auto plain = churn(n, 64);
+
+    uut.setProfiler(&profiler);
+    profiler.setInterval(Profiler::defaultInterval);
+    const auto sampled = churn(n, 64);
+
+    // Relative overhead in hundredths of a percent, the target is well under 1%.
+    const long long delta = (long long)sampled - (long long)plain;
+    const auto hundredths = plain ? delta * 10000 / (long long)plain : 0;
+    const auto magnitude = (unsigned int)(hundredths < 0 ? -hundredths : hundredths);
+
+    Report::info() << "sampling overhead: " << plain << " us -> " << sampled << " us ("
+            << (hundredths < 0 ? "-" : "") << magnitude / 100 << "." << magnitude / 10 % 10 << magnitude % 10 << "%), "
+            << profiler.getSampleCount() << " samples\n";
+
+    // 64 MB at the default mean spacing of 512 KiB is only about a hundred backtraces.
+    CHECK(profiler.getSampleCount() < n / 1000);
+}
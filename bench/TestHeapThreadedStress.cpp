@@ -0,0 +1,74 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#include "1test/Test.h"
+
+#include "heap/TlsfPolicy.h"
+#include "heap/ThreadCache.h"
+
+#include "TestHeapThreadedStress.h"
+
+#include <cstdlib>
+#include <malloc.h>
+#include <unistd.h>
+
+using namespace pet;
+
+template class ThreadedHeapStress<LockedHeap<TlsfHeap<uint32_t, 2, true>>, 1024*1024, 100000, 0, 256>;
+template class ThreadedHeapStress<ThreadCachingHeap<TlsfHeap<uint32_t, 2, true>, std::mutex>, 1024*1024, 100000, 0, 256>;
+template class ThreadedHeapStress<SystemHeap, 1024, 100000, 0, 256>;
+
+/*
+ * Checks the system allocator, that is the interposer of preload/ when it is
+ * preloaded into this binary.
+ */
+TEST_GROUP(SystemAllocator) {};
+
+TEST(SystemAllocator, Alignment)
+{
+    for(size_t alignment: {16, 32, 64})
+    {
+        for(size_t size: {1, 24, 100, 4096})
+        {
+            void* p = nullptr;
+            CHECK(posix_memalign(&p, alignment, size) == 0);
+            CHECK(p && !((uintptr_t)p % alignment));
+            free(p);
+
+            p = aligned_alloc(alignment, size);
+            CHECK(p && !((uintptr_t)p % alignment));
+            free(p);
+
+            p = memalign(alignment, size);
+            CHECK(p && !((uintptr_t)p % alignment));
+            free(p);
+        }
+    }
+
+    const auto pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+
+    auto p = valloc(100);
+    CHECK(p && !((uintptr_t)p % pageSize));
+    free(p);
+
+    p = pvalloc(100);
+    CHECK(p && !((uintptr_t)p % pageSize));
+    CHECK(malloc_usable_size(p) >= pageSize);
+    free(p);
+}
@@ -0,0 +1,246 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+#ifndef HEAPTHREADEDSTRESS_H_
+#define HEAPTHREADEDSTRESS_H_
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <cstdlib>
+#include <cstring>
+
+#include "ubiquitous/Trace.h"
+
+using namespace pet;
+
+class HeapBenchmarkTraceTag;
+
+/*
+ * Baseline front end: every operation goes through one global lock.
+ *
+ * Has the same shape as the thread caching front end (per thread Cache
+ * objects) so that the two can be measured by the same harness.
+ */
+template<class Heap>
+struct LockedHeap: Heap
+{
+    std::mutex lock;
+
+    inline LockedHeap(void* mem, unsigned int size): Heap(mem, size) {}
+
+    struct Cache
+    {
+        LockedHeap &owner;
+
+        inline Cache(LockedHeap &owner): owner(owner) {}
+
+        inline void* alloc(unsigned int size, bool hot = false)
+        {
+            std::lock_guard<std::mutex> _(owner.lock);
+            return owner.Heap::alloc(size, hot);
+        }
+
+        inline void free(void* ptr)
+        {
+            std::lock_guard<std::mutex> _(owner.lock);
+            owner.Heap::free(ptr);
+        }
+    };
+};
+
+/*
+ * Front end forwarding to the system malloc, so that the same workload can be
+ * measured against whatever implementation the binary runs with (glibc or an
+ * LD_PRELOAD-ed replacement). The arena passed in is not used.
+ */
+struct SystemHeap
+{
+    struct Stats
+    {
+        unsigned int nUsed, totalUsed;
+    };
+
+    std::atomic<unsigned int> nUsed{0};
+
+    inline SystemHeap(void*, unsigned int) {}
+
+    inline Stats getStats(void*) {
+        return {nUsed, 0};
+    }
+
+    struct Cache
+    {
+        SystemHeap &owner;
+
+        inline Cache(SystemHeap &owner): owner(owner) {}
+
+        inline void* alloc(unsigned int size, bool hot = false)
+        {
+            auto ret = ::malloc(size);
+
+            if(ret)
+            {
+                owner.nUsed++;
+            }
+
+            return ret;
+        }
+
+        inline void free(void* ptr)
+        {
+            owner.nUsed--;
+            ::free(ptr);
+        }
+    };
+};
+
+template <class Frontend, unsigned int heapSize, unsigned int opsPerThread, unsigned int minAlloc, unsigned int maxAlloc>
+class ThreadedHeapStress: pet::Trace<HeapBenchmarkTraceTag>
+{
+    TEST_GROUP(ThreadedHeapStress)
+    {
+        static constexpr unsigned int maxThreads = 16;
+        static constexpr unsigned int slotsPerThread = 64;
+
+        struct Uut: Frontend
+        {
+            uint32_t data[heapSize / sizeof(uint32_t)];
+            Uut(): Frontend(data, sizeof(data)) {}
+        };
+
+        Uut heap;
+
+        static unsigned int random(uint32_t &state, unsigned int l, unsigned int h)
+        {
+            state = state * 1103515245 + 12345;
+            return l + ((state >> 16) % (h - l + 1));
+        }
+
+        /*
+         * Every thread owns a fixed number of slots, each either empty or holding a block
+         * filled with a thread specific pattern. Blocks are checked before being released,
+         * so handing out overlapping blocks to different threads is detected.
+         */
+        bool worker(uint8_t pattern)
+        {
+            typename Frontend::Cache cache(heap);
+
+            void* ptrs[slotsPerThread] = {nullptr, };
+            unsigned int sizes[slotsPerThread];
+            uint32_t state = pattern;
+            bool ok = true;
+
+            auto release = [&](unsigned int idx)
+            {
+                for(unsigned int i = 0; i < sizes[idx]; i++)
+                {
+                    if(((uint8_t*)ptrs[idx])[i] != pattern)
+                    {
+                        ok = false;
+                        break;
+                    }
+                }
+
+                cache.free(ptrs[idx]);
+                ptrs[idx] = nullptr;
+            };
+
+            for(unsigned int i = 0; i < opsPerThread; i++)
+            {
+                const auto idx = random(state, 0, slotsPerThread - 1);
+
+                if(ptrs[idx])
+                {
+                    release(idx);
+                }
+                else
+                {
+                    const auto size = random(state, minAlloc, maxAlloc);
+
+                    if(auto ptr = cache.alloc(size))
+                    {
+                        memset(ptr, pattern, size);
+                        ptrs[idx] = ptr;
+                        sizes[idx] = size;
+                    }
+                }
+            }
+
+            for(unsigned int idx = 0; idx < slotsPerThread; idx++)
+            {
+                if(ptrs[idx])
+                {
+                    release(idx);
+                }
+            }
+
+            return ok;
+        }
+
+        /*
+         * Runs the workload on the specified number of threads, returns ops/sec.
+         */
+        unsigned long run(unsigned int nThreads)
+        {
+            std::thread threads[maxThreads];
+            bool results[maxThreads];
+
+            const auto start = std::chrono::steady_clock::now();
+
+            for(unsigned int i = 0; i < nThreads; i++)
+            {
+                threads[i] = std::thread([this, &results, i](){
+                    results[i] = worker(uint8_t(i + 1));
+                });
+            }
+
+            for(unsigned int i = 0; i < nThreads; i++)
+            {
+                threads[i].join();
+            }
+
+            const auto end = std::chrono::steady_clock::now();
+
+            for(unsigned int i = 0; i < nThreads; i++)
+            {
+                CHECK(results[i]);
+            }
+
+            const auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+            return (unsigned long)((unsigned long long)nThreads * opsPerThread * 1000000 / (us ? us : 1));
+        }
+    };
+
+    BEGIN_TEST_CASE(ThreadedHeapStress, Scaling)
+    {
+        for(unsigned int n = 1; n <= this->maxThreads; n <<= 1)
+        {
+            const auto opsPerSec = this->run(n);
+            ThreadedHeapStress::info() << n << " threads: " << opsPerSec << " ops/s\n";
+        }
+
+        auto s = this->heap.getStats(this->heap.data);
+        CHECK(s.nUsed == 0 && s.totalUsed == 0);
+    }
+    END_TEST_CASE()
+};
+
+#endif /* HEAPTHREADEDSTRESS_H_ */
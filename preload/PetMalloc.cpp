@@ -0,0 +1,395 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+/*
+ * Drop-in malloc replacement on top of TlsfHeap arenas.
+ *
+ *     LD_PRELOAD=preload/libpet-malloc.so bench/pet-heap-bench
+ *
+ * Threads are assigned one of a fixed set of arenas round robin on their first
+ * allocation, each arena has its own lock and grows through mmap by adding new
+ * regions when it runs out. Every block is preceded by a small prefix holding
+ * the owning arena, so that blocks can be freed from any thread. Requests above
+ * the huge threshold are mapped directly and returned to the system on free.
+ */
+
+#include "heap/TlsfPolicy.h"
+#include "heap/MmapGrowth.h"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+using ArenaHeap = pet::TlsfHeap<uint32_t, 4, false>;
+
+static constexpr size_t arenaAlignment = 1u << 4; // Blocks of ArenaHeap are aligned to this much.
+static constexpr size_t initialArenaSize = 16 << 20;
+static constexpr size_t growthSize = 64 << 20;
+static constexpr size_t hugeThreshold = 1 << 20;
+static constexpr unsigned int maxArenas = 64;
+
+struct Arena
+{
+    std::mutex lock;
+    ArenaHeap heap;
+
+    inline Arena(void* mem, size_t size): heap(mem, (unsigned int)size) {
+        heap.setGrowthHook(&pet::mmapGrowthHook<ArenaHeap, growthSize>);
+    }
+};
+
+/*
+ * Stored right in front of every block handed out, keeps the alignment
+ * guaranteed by malloc. The arena is null for directly mapped blocks.
+ */
+struct alignas(16) Prefix
+{
+    Arena* arena;
+    uint32_t offset;
+    uint32_t size;
+    size_t mappedSize;
+};
+
+static Arena* arenas[maxArenas];
+static std::mutex arenaCreationLock;
+static std::atomic<unsigned int> nextArena;
+static thread_local Arena* threadArena;
+
+static Arena* createArena()
+{
+    void* mem = mmap(nullptr, initialArenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(mem == MAP_FAILED)
+        return nullptr;
+
+    const auto headerSize = (sizeof(Arena) + 15) & ~size_t(15);
+    return new(mem) Arena((char*)mem + headerSize, initialArenaSize - headerSize);
+}
+
+static Arena* getArena()
+{
+    if(!threadArena)
+    {
+        const auto idx = nextArena++ % maxArenas;
+
+        std::lock_guard<std::mutex> _(arenaCreationLock);
+
+        if(!arenas[idx])
+            arenas[idx] = createArena();
+
+        threadArena = arenas[idx];
+    }
+
+    return threadArena;
+}
+
+static inline Prefix* prefixOf(void* ptr) {
+    return (Prefix*)ptr - 1;
+}
+
+/*
+ * The mapping is only page aligned, so for larger alignments enough is mapped
+ * to find an aligned address with room for the prefix in front of it.
+ */
+static void* allocMapped(size_t size, size_t alignment)
+{
+    const auto pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    const auto slack = sizeof(Prefix) + (alignment > sizeof(Prefix) ? alignment : 0);
+
+    if(size > SIZE_MAX - slack - pageSize)
+        return nullptr;
+
+    const auto mappedSize = (size + slack + pageSize - 1) & ~(pageSize - 1);
+
+    void* mem = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(mem == MAP_FAILED)
+        return nullptr;
+
+    const auto align = alignment > sizeof(Prefix) ? alignment : sizeof(Prefix);
+    auto ret = (char*)(((uintptr_t)mem + sizeof(Prefix) + align - 1) & ~(uintptr_t)(align - 1));
+    *prefixOf(ret) = Prefix{nullptr, (uint32_t)(ret - (char*)mem), 0, mappedSize};
+    return ret;
+}
+
+static void* allocate(size_t size, size_t alignment = arenaAlignment)
+{
+    // The offset of the block from the prefix has to fit in 32 bits.
+    if(alignment > UINT32_MAX / 2)
+        return nullptr;
+
+    if(size >= hugeThreshold || alignment >= hugeThreshold)
+        return allocMapped(size, alignment);
+
+    auto arena = getArena();
+
+    if(!arena)
+        return nullptr;
+
+    const auto offset = alignment > sizeof(Prefix) ? alignment : sizeof(Prefix);
+    char* block;
+
+    {
+        std::lock_guard<std::mutex> _(arena->lock);
+
+        block = (char*)((alignment > arenaAlignment)
+                ? arena->heap.allocAligned((unsigned int)(size + offset), (unsigned int)alignment)
+                : arena->heap.alloc((unsigned int)(size + offset)));
+    }
+
+    if(!block)
+        return nullptr;
+
+    auto ret = block + offset;
+    *prefixOf(ret) = Prefix{arena, (uint32_t)offset, (uint32_t)size, 0};
+    return ret;
+}
+
+static void release(void* ptr)
+{
+    const auto prefix = *prefixOf(ptr);
+    const auto block = (char*)ptr - prefix.offset;
+
+    if(!prefix.arena)
+    {
+        munmap(block, prefix.mappedSize);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> _(prefix.arena->lock);
+        prefix.arena->heap.free(block);
+    }
+}
+
+static size_t usableSize(void* ptr)
+{
+    const auto &prefix = *prefixOf(ptr);
+    return prefix.arena ? prefix.size : prefix.mappedSize - prefix.offset;
+}
+
+static void* reallocate(void* ptr, size_t size)
+{
+    auto prefix = prefixOf(ptr);
+
+    if(size <= usableSize(ptr))
+    {
+        if(prefix->arena)
+            prefix->size = (uint32_t)size;
+
+        return ptr;
+    }
+
+    if(prefix->arena && size < hugeThreshold && prefix->offset == sizeof(Prefix))
+    {
+        auto arena = prefix->arena;
+        char* block;
+
+        {
+            std::lock_guard<std::mutex> _(arena->lock);
+            block = (char*)arena->heap.reallocate((char*)prefix, (unsigned int)(size + sizeof(Prefix)));
+        }
+
+        if(block)
+        {
+            auto ret = block + sizeof(Prefix);
+            prefixOf(ret)->size = (uint32_t)size;
+            return ret;
+        }
+    }
+    else if(!prefix->arena)
+    {
+        const auto pageSize = (size_t)sysconf(_SC_PAGESIZE);
+        const auto mappedSize = (size + prefix->offset + pageSize - 1) & ~(pageSize - 1);
+        auto block = (char*)ptr - prefix->offset;
+        auto moved = (char*)mremap(block, prefix->mappedSize, mappedSize, MREMAP_MAYMOVE);
+
+        if(moved != MAP_FAILED)
+        {
+            auto ret = moved + ((char*)ptr - block);
+            prefixOf(ret)->mappedSize = mappedSize;
+            return ret;
+        }
+    }
+
+    auto ret = allocate(size);
+
+    if(ret)
+    {
+        memcpy(ret, ptr, usableSize(ptr));
+        release(ptr);
+    }
+
+    return ret;
+}
+
+static inline bool isValidAlignment(size_t alignment) {
+    return alignment && !(alignment & (alignment - 1));
+}
+
+/*
+ * A child forked while another thread holds an arena lock would never see it
+ * released, so all of them are taken around fork.
+ */
+static void lockAll()
+{
+    arenaCreationLock.lock();
+
+    for(auto arena: arenas)
+    {
+        if(arena)
+            arena->lock.lock();
+    }
+}
+
+static void unlockAll()
+{
+    for(auto arena: arenas)
+    {
+        if(arena)
+            arena->lock.unlock();
+    }
+
+    arenaCreationLock.unlock();
+}
+
+static const int forkHandlersRegistered = pthread_atfork(&lockAll, &unlockAll, &unlockAll);
+
+}
+
+extern "C" {
+
+void* malloc(size_t size)
+{
+    auto ret = allocate(size);
+
+    if(!ret)
+        errno = ENOMEM;
+
+    return ret;
+}
+
+void free(void* ptr)
+{
+    if(ptr)
+        release(ptr);
+}
+
+void* calloc(size_t n, size_t size)
+{
+    size_t total;
+
+    if(__builtin_mul_overflow(n, size, &total))
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    auto ret = malloc(total);
+
+    if(ret)
+        memset(ret, 0, total);
+
+    return ret;
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    if(!ptr)
+        return malloc(size);
+
+    if(!size)
+    {
+        release(ptr);
+        return nullptr;
+    }
+
+    auto ret = reallocate(ptr, size);
+
+    if(!ret)
+        errno = ENOMEM;
+
+    return ret;
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size)
+{
+    if(!isValidAlignment(alignment) || alignment % sizeof(void*))
+        return EINVAL;
+
+    auto ret = allocate(size, alignment);
+
+    if(!ret)
+        return ENOMEM;
+
+    *out = ret;
+    return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    if(!isValidAlignment(alignment))
+    {
+        errno = EINVAL;
+        return nullptr;
+    }
+
+    auto ret = allocate(size, alignment);
+
+    if(!ret)
+        errno = ENOMEM;
+
+    return ret;
+}
+
+void* memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+void* valloc(size_t size) {
+    return memalign((size_t)sysconf(_SC_PAGESIZE), size);
+}
+
+void* pvalloc(size_t size)
+{
+    const auto pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+    if(size > SIZE_MAX - pageSize)
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    return memalign(pageSize, (size + pageSize - 1) & ~(pageSize - 1));
+}
+
+size_t malloc_usable_size(void* ptr) {
+    return ptr ? usableSize(ptr) : 0;
+}
+
+}
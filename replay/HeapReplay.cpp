@@ -0,0 +1,327 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2020 Tamás Seller. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *******************************************************************************/
+
+/*
+ * Replays a binary heap trace recorded through RecordingHeap/HeapTraceFile
+ * against every heap policy, the buddy allocator and the system malloc.
+ *
+ * Usage: pet-heap-replay <trace file> [arena size in MiB]
+ *
+ * Reports per operation latency percentiles, peak footprint and the
+ * fragmentation (1 - longestFree / totalFree) sampled over the run.
+ */
+
+#include "heap/AvlTreePolicy.h"
+#include "heap/BestFitPolicy.h"
+#include "heap/TlsfPolicy.h"
+#include "heap/Buddy.h"
+#include "heap/HeapTrace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+
+using namespace pet;
+
+static constexpr unsigned int nFragmentationSamples = 10;
+
+/*
+ * Adapters giving a uniform interface to the contenders. The methods doing the
+ * actual work are timed, so any bookkeeping is kept out of them: sizes of the
+ * live blocks as accounted by the contender are tracked by the replay loop.
+ * Resize may move the block, like realloc does for the system malloc.
+ */
+template<class Heap>
+struct HeapContender
+{
+    std::unique_ptr<uint64_t[]> arena;
+    const size_t arenaSize;
+    Heap heap;
+    size_t peak = 0;
+
+    HeapContender(size_t arenaSize):
+        arena(new uint64_t[arenaSize / sizeof(uint64_t)]),
+        arenaSize(arenaSize),
+        heap(arena.get(), arenaSize) {}
+
+    void* alloc(uint32_t size, bool hot, uint32_t &actual)
+    {
+        actual = size;
+        return heap.alloc(size, hot);
+    }
+
+    uint32_t resize(void* &ptr, uint32_t, uint32_t size) {
+        return heap.resize(ptr, size);
+    }
+
+    void free(void* ptr) {
+        heap.free(ptr);
+    }
+
+    void sample(size_t)
+    {
+        auto s = heap.getStats();
+        peak = std::max(peak, (size_t)s.totalUsed);
+    }
+
+    bool fragmentation(double &ret)
+    {
+        auto s = heap.getStats();
+        ret = s.totalFree ? 1.0 - (double)s.longestFree / s.totalFree : 0.0;
+        return true;
+    }
+};
+
+template<class Buddy, unsigned int unitBits>
+struct BuddyContender
+{
+    std::unique_ptr<uint64_t[]> arena;
+    std::unique_ptr<char[]> tree;
+    Buddy buddy;
+    size_t peak = 0;
+
+    BuddyContender(size_t arenaSize): arena(new uint64_t[arenaSize / sizeof(uint64_t)])
+    {
+        const auto treeSize = Buddy::minimalTreeSize(arenaSize);
+        tree.reset(new char[treeSize]);
+
+        if(!buddy.init((char*)arena.get(), (char*)arena.get() + arenaSize, tree.get(), treeSize))
+        {
+            fprintf(stderr, "Could not set up the buddy allocator over a %zu MiB arena\n", arenaSize >> 20);
+            exit(-1);
+        }
+    }
+
+    /*
+     * Size of the block the buddy uses for a request, the smallest power of two
+     * multiple of the allocation unit that holds it.
+     */
+    static uint32_t blockSize(uint32_t size)
+    {
+        uint32_t ret = 1u << unitBits;
+
+        while(ret < size)
+            ret <<= 1;
+
+        return ret;
+    }
+
+    void* alloc(uint32_t size, bool, uint32_t &actual) {
+        return buddy.allocate(size, actual);
+    }
+
+    uint32_t resize(void* &ptr, uint32_t old, uint32_t size) {
+        return buddy.adjust(ptr, size) ? blockSize(size) : old;
+    }
+
+    void free(void* ptr) {
+        buddy.free(ptr);
+    }
+
+    void sample(size_t used) {
+        peak = std::max(peak, used);
+    }
+
+    bool fragmentation(double &) {
+        return false;
+    }
+};
+
+struct MallocContender
+{
+    size_t peak = 0;
+
+    MallocContender(size_t) {}
+
+    void* alloc(uint32_t size, bool, uint32_t &actual)
+    {
+        actual = size;
+        return ::malloc(size ? size : 1);
+    }
+
+    uint32_t resize(void* &ptr, uint32_t old, uint32_t size)
+    {
+        auto moved = ::realloc(ptr, size ? size : 1);
+
+        if(!moved)
+            return old;
+
+        ptr = moved;
+        return size;
+    }
+
+    void free(void* ptr) {
+        ::free(ptr);
+    }
+
+    void sample(size_t) {
+        peak = std::max(peak, mallinfo2().uordblks);
+    }
+
+    bool fragmentation(double &) {
+        return false;
+    }
+};
+
+template<class Contender>
+static void replay(const char* name, const std::vector<HeapTraceRecord> &trace, size_t arenaSize)
+{
+    struct Block
+    {
+        void* ptr;
+        uint32_t size;
+    };
+
+    Contender uut(arenaSize);
+    std::unordered_map<uint64_t, Block> live;
+    std::vector<uint32_t> latencies;
+    double fragmentation[nFragmentationSamples];
+    unsigned int nFragmentation = 0, nFailed = 0;
+    size_t used = 0;
+
+    latencies.reserve(trace.size());
+
+    const auto sampleInterval = trace.size() / nFragmentationSamples + 1;
+
+    auto timed = [&latencies](auto &&op)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const auto ret = op();
+        const auto end = std::chrono::steady_clock::now();
+        latencies.push_back((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        return ret;
+    };
+
+    for(size_t i = 0; i < trace.size(); i++)
+    {
+        const auto &r = trace[i];
+
+        switch(r.op)
+        {
+        case HeapTraceRecord::Op::Alloc:
+        case HeapTraceRecord::Op::AllocHot:
+            if(r.ptr)
+            {
+                const bool hot = r.op == HeapTraceRecord::Op::AllocHot;
+                uint32_t actual;
+
+                if(auto ptr = timed([&](){ return uut.alloc(r.size, hot, actual); }))
+                {
+                    live[r.ptr] = Block{ptr, actual};
+                    used += actual;
+                }
+                else
+                {
+                    nFailed++;
+                }
+            }
+            break;
+        case HeapTraceRecord::Op::Resize:
+            if(auto it = live.find(r.ptr); it != live.end())
+            {
+                auto &b = it->second;
+                const auto size = timed([&](){ return uut.resize(b.ptr, b.size, r.size); });
+                used = used - b.size + size;
+                b.size = size;
+            }
+            break;
+        case HeapTraceRecord::Op::Free:
+            if(auto it = live.find(r.ptr); it != live.end())
+            {
+                timed([&](){ uut.free(it->second.ptr); return true; });
+                used -= it->second.size;
+                live.erase(it);
+            }
+            break;
+        }
+
+        uut.sample(used);
+
+        if(i % sampleInterval == sampleInterval - 1 && nFragmentation < nFragmentationSamples)
+        {
+            if(uut.fragmentation(fragmentation[nFragmentation]))
+                nFragmentation++;
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&latencies](double p) {
+        return latencies.empty() ? 0u : latencies[(size_t)(p * (latencies.size() - 1))];
+    };
+
+    printf("%-12s p50 %6u ns  p90 %6u ns  p99 %6u ns  p99.9 %6u ns  max %8u ns  peak %10zu B  failed %u\n",
+            name, percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999), percentile(1.0), uut.peak, nFailed);
+
+    if(nFragmentation)
+    {
+        printf("%-12s fragmentation:", "");
+
+        for(unsigned int i = 0; i < nFragmentation; i++)
+            printf(" %.3f", fragmentation[i]);
+
+        printf("\n");
+    }
+
+    for(auto &l: live)
+        uut.free(l.second.ptr);
+}
+
+int main(int argc, const char* argv[])
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <trace file> [arena size in MiB]\n", argv[0]);
+        return -1;
+    }
+
+    auto f = fopen(argv[1], "rb");
+
+    if(!f)
+    {
+        fprintf(stderr, "Could not open trace file '%s'\n", argv[1]);
+        return -1;
+    }
+
+    std::vector<HeapTraceRecord> trace;
+    HeapTraceRecord r;
+
+    while(fread(&r, sizeof(r), 1, f) == 1)
+        trace.push_back(r);
+
+    fclose(f);
+
+    const size_t arenaSize = size_t(argc > 2 ? atoi(argv[2]) : 64) << 20;
+
+    printf("%zu operations, %zu MiB arena\n", trace.size(), arenaSize >> 20);
+
+    replay<HeapContender<AvlHeap<uint32_t, 3, false>>>("avl", trace, arenaSize);
+    replay<HeapContender<BestFitHeap<uint32_t, 3, false>>>("best-fit", trace, arenaSize);
+    replay<HeapContender<TlsfHeap<uint32_t, 3, false>>>("tlsf", trace, arenaSize);
+    replay<BuddyContender<BuddyAllocator<3, 2>, 3>>("buddy", trace, arenaSize);
+    replay<MallocContender>("malloc", trace, arenaSize);
+
+    return 0;
+}